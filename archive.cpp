@@ -0,0 +1,281 @@
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <zlib.h>
+
+#include "archive.h"
+#include "reader.h"
+
+#define EOCD_SIGNATURE          0x06054b50
+#define CENTRAL_FILE_SIGNATURE  0x02014b50
+#define LOCAL_FILE_SIGNATURE    0x04034b50
+
+#define EOCD_SIZE               22
+#define CENTRAL_FILE_SIZE       46
+#define LOCAL_FILE_SIZE         30
+
+struct archive {
+    const char * ptr;
+    size_t size;
+
+    struct archive_entry * entries;
+    int count;
+
+    // inflate target, grows to the largest deflated entry read so far
+    char * buffer;
+    size_t bufferSize;
+};
+
+static const char * find_end_of_central_directory(const char * ptr, size_t size)
+{
+    if (size < EOCD_SIZE) {
+        return 0;
+    }
+
+    // the record is at the end, followed by a comment of up to 64k
+    size_t min = size > EOCD_SIZE + 0xFFFF ? size - EOCD_SIZE - 0xFFFF : 0;
+    for (size_t pos = size - EOCD_SIZE + 1; pos-- > min; ) {
+        if (*(uint32_t*)(ptr + pos) == EOCD_SIGNATURE) {
+            return ptr + pos;
+        }
+    }
+    return 0;
+}
+
+static int read_central_directory(struct archive * archive)
+{
+    const char * eocd = find_end_of_central_directory(archive->ptr, archive->size);
+    if (eocd == 0) {
+        fprintf(stderr, " read zip error, no end of central directory\n");
+        return -1;
+    }
+
+    struct buffer buffer;
+    buffer_init(&buffer, eocd, EOCD_SIZE);
+    buffer_read_u32(&buffer); // signature
+    buffer_read_u16(&buffer); // number of this disk
+    buffer_read_u16(&buffer); // disk where central directory starts
+    buffer_read_u16(&buffer); // number of central directory records on this disk
+    uint16_t count = buffer_read_u16(&buffer);
+    uint32_t directorySize = buffer_read_u32(&buffer);
+    uint32_t directoryOffset = buffer_read_u32(&buffer);
+
+    if (count == 0xFFFF || directoryOffset == 0xFFFFFFFF) {
+        fprintf(stderr, " read zip error, zip64 archives are not supported\n");
+        return -1;
+    }
+
+    if ((uint64_t)directoryOffset + directorySize > archive->size) {
+        fprintf(stderr, " read zip error, central directory out of range\n");
+        return -1;
+    }
+
+    archive->entries = (struct archive_entry*)calloc(count > 0 ? count : 1, sizeof(struct archive_entry));
+    archive->count = 0;
+
+    const char * ptr = archive->ptr + directoryOffset;
+    const char * end = ptr + directorySize;
+
+    for (int i = 0; i < count; i++) {
+        if (end - ptr < CENTRAL_FILE_SIZE || *(uint32_t*)ptr != CENTRAL_FILE_SIGNATURE) {
+            fprintf(stderr, " read zip error, bad central directory record %d\n", i);
+            return -1;
+        }
+
+        buffer_init(&buffer, ptr, end - ptr);
+        buffer_read_u32(&buffer); // signature
+        buffer_read_u16(&buffer); // version made by
+        buffer_read_u16(&buffer); // version needed
+        uint16_t flags = buffer_read_u16(&buffer);
+        uint16_t method = buffer_read_u16(&buffer);
+        buffer_read_u32(&buffer); // modification time and date
+        buffer_read_u32(&buffer); // crc-32
+        uint32_t compressedSize = buffer_read_u32(&buffer);
+        uint32_t size = buffer_read_u32(&buffer);
+        uint16_t nameLen = buffer_read_u16(&buffer);
+        uint16_t extraLen = buffer_read_u16(&buffer);
+        uint16_t commentLen = buffer_read_u16(&buffer);
+        buffer_read_u16(&buffer); // disk number start
+        buffer_read_u16(&buffer); // internal attributes
+        buffer_read_u32(&buffer); // external attributes
+        uint32_t offset = buffer_read_u32(&buffer);
+
+        if ((size_t)(end - ptr) < (size_t)CENTRAL_FILE_SIZE + nameLen + extraLen + commentLen) {
+            fprintf(stderr, " read zip error, central directory record %d truncated\n", i);
+            return -1;
+        }
+
+        // encrypted entries can't be read
+        if ((flags & 0x1) == 0) {
+            struct archive_entry * entry = archive->entries + archive->count++;
+            entry->name = ptr + CENTRAL_FILE_SIZE;
+            entry->nameLen = nameLen;
+            entry->method = method;
+            entry->compressedSize = compressedSize;
+            entry->size = size;
+            entry->offset = offset;
+        }
+
+        ptr += CENTRAL_FILE_SIZE + nameLen + extraLen + commentLen;
+    }
+
+    return 0;
+}
+
+struct archive * archive_open(const char * filename)
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+
+    void * ptr = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (ptr == MAP_FAILED) {
+        return 0;
+    }
+
+    struct archive * archive = (struct archive*)calloc(1, sizeof(struct archive));
+    archive->ptr = (const char*)ptr;
+    archive->size = st.st_size;
+
+    if (read_central_directory(archive) != 0) {
+        archive_close(archive);
+        return 0;
+    }
+
+    return archive;
+}
+
+void archive_close(struct archive * archive)
+{
+    if (archive == 0) {
+        return;
+    }
+
+    munmap((void*)archive->ptr, archive->size);
+    free(archive->entries);
+    free(archive->buffer);
+    free(archive);
+}
+
+int archive_count(struct archive * archive)
+{
+    return archive->count;
+}
+
+const struct archive_entry * archive_get_entry(struct archive * archive, int index)
+{
+    if (index < 0 || index >= archive->count) {
+        return 0;
+    }
+    return archive->entries + index;
+}
+
+int archive_entry_has_suffix(const struct archive_entry * entry, const char * suffix)
+{
+    size_t len = strlen(suffix);
+    if (entry->nameLen < len) {
+        return 0;
+    }
+
+    const char * name = entry->name + entry->nameLen - len;
+    for (size_t i = 0; i < len; i++) {
+        if (tolower((unsigned char)name[i]) != tolower((unsigned char)suffix[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static const char * inflate_entry(struct archive * archive, const char * data, const struct archive_entry * entry)
+{
+    if (archive->bufferSize < entry->size) {
+        free(archive->buffer);
+        archive->buffer = (char*)malloc(entry->size);
+        archive->bufferSize = archive->buffer ? entry->size : 0;
+        if (archive->buffer == 0) {
+            return 0;
+        }
+    }
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+
+    // raw deflate, zip has no zlib header
+    if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+        return 0;
+    }
+
+    stream.next_in = (Bytef*)data;
+    stream.avail_in = entry->compressedSize;
+    stream.next_out = (Bytef*)archive->buffer;
+    stream.avail_out = entry->size;
+
+    int ret = inflate(&stream, Z_FINISH);
+    inflateEnd(&stream);
+
+    if (ret != Z_STREAM_END || stream.total_out != entry->size) {
+        return 0;
+    }
+
+    return archive->buffer;
+}
+
+const char * archive_read(struct archive * archive, int index, size_t * size)
+{
+    const struct archive_entry * entry = archive_get_entry(archive, index);
+    if (entry == 0) {
+        return 0;
+    }
+
+    if (entry->offset + LOCAL_FILE_SIZE > archive->size) {
+        return 0;
+    }
+
+    const char * local = archive->ptr + entry->offset;
+    if (*(uint32_t*)local != LOCAL_FILE_SIGNATURE) {
+        return 0;
+    }
+
+    // name and extra field lengths of the local header may differ from the central directory
+    uint16_t nameLen = *(uint16_t*)(local + 26);
+    uint16_t extraLen = *(uint16_t*)(local + 28);
+
+    uint64_t offset = entry->offset + LOCAL_FILE_SIZE + nameLen + extraLen;
+    if (offset > archive->size || entry->compressedSize > archive->size - offset) {
+        return 0;
+    }
+
+    const char * data = archive->ptr + offset;
+
+    if (size) *size = entry->size;
+
+    switch (entry->method) {
+        case 0:
+            if (entry->compressedSize != entry->size) {
+                return 0;
+            }
+            return data;
+        case 8:
+            return inflate_entry(archive, data, entry);
+        default:
+            return 0;
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef _CLRPARSER_ARCHIVE_H_
+#define _CLRPARSER_ARCHIVE_H_
+
+#include <stdlib.h>
+#include <stdint.h>
+
+// read-only access to the members of a zip file (.nupkg, .zip) without
+// extracting them. the archive is mapped, stored members are returned as
+// pointers into the mapping and deflated members are inflated into one
+// buffer owned by the archive that is reused by the next archive_read.
+
+struct archive;
+
+struct archive_entry {
+    const char * name;      // not null terminated
+    size_t nameLen;
+
+    int method;             // 0 stored, 8 deflated
+    uint64_t compressedSize;
+    uint64_t size;
+    uint64_t offset;        // of the local file header
+};
+
+struct archive * archive_open(const char * filename);
+void archive_close(struct archive * archive);
+
+int archive_count(struct archive * archive);
+const struct archive_entry * archive_get_entry(struct archive * archive, int index);
+
+// 1 when the entry name ends with suffix, ignoring case
+int archive_entry_has_suffix(const struct archive_entry * entry, const char * suffix);
+
+// content of an entry, valid until the next archive_read or archive_close
+const char * archive_read(struct archive * archive, int index, size_t * size);
+
+#endif
@@ -0,0 +1,75 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+struct ArenaChunk {
+    struct ArenaChunk * next;
+    size_t size;
+    char data[];
+};
+
+void arena_init(struct Arena * arena, size_t chunkSize)
+{
+    arena->chunk = 0;
+    arena->used = 0;
+    arena->chunkSize = chunkSize;
+}
+
+void arena_free(struct Arena * arena)
+{
+    struct ArenaChunk * chunk = arena->chunk;
+    while (chunk) {
+        struct ArenaChunk * next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+
+    arena->chunk = 0;
+    arena->used = 0;
+}
+
+void arena_reset(struct Arena * arena)
+{
+    struct ArenaChunk * chunk = arena->chunk;
+    if (chunk == 0) {
+        return;
+    }
+
+    struct ArenaChunk * next = chunk->next;
+    while (next) {
+        struct ArenaChunk * n = next->next;
+        free(next);
+        next = n;
+    }
+
+    chunk->next = 0;
+    arena->used = 0;
+}
+
+void * arena_alloc(struct Arena * arena, size_t size)
+{
+    size = (size + 7) & ~(size_t)7;
+
+    if (arena->chunk == 0 || arena->used + size > arena->chunk->size) {
+        // oversized requests get a chunk of their own
+        size_t chunkSize = (size > arena->chunkSize) ? size : arena->chunkSize;
+
+        struct ArenaChunk * chunk = (struct ArenaChunk*)malloc(sizeof(struct ArenaChunk) + chunkSize);
+        if (chunk == 0) {
+            return 0;
+        }
+
+        chunk->next = arena->chunk;
+        chunk->size = chunkSize;
+        arena->chunk = chunk;
+        arena->used = 0;
+    }
+
+    void * ptr = arena->chunk->data + arena->used;
+    arena->used += size;
+
+    memset(ptr, 0, size);
+    return ptr;
+}
@@ -0,0 +1,27 @@
+#ifndef _CLRPARSER_ARENA_H_
+#define _CLRPARSER_ARENA_H_
+
+#include <stdlib.h>
+
+// bump allocator, everything is released at once by arena_free. not
+// thread safe, callers serialize.
+
+struct ArenaChunk;
+
+struct Arena {
+    struct ArenaChunk * chunk;
+    size_t used;
+    size_t chunkSize;
+};
+
+void arena_init(struct Arena * arena, size_t chunkSize);
+void arena_free(struct Arena * arena);
+
+// releases everything allocated so far but keeps the newest chunk for
+// the next round
+void arena_reset(struct Arena * arena);
+
+// 8 byte aligned, zero filled
+void * arena_alloc(struct Arena * arena, size_t size);
+
+#endif
@@ -0,0 +1,630 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "attribute.h"
+#include "lookup.h"
+#include "owner.h"
+#include "symbol.h"
+#include "signature.h"
+#include "arena.h"
+
+#define ATTRIBUTE_NAME_MAX 2048
+#define ATTRIBUTE_ARENA_CHUNK (16 * 1024)
+
+// FieldOrPropType tags of the blob encoding that signatures do not have
+#define ATTRIBUTE_TYPE_SYSTEM_TYPE 0x50
+#define ATTRIBUTE_TYPE_BOXED       0x51
+#define ATTRIBUTE_TYPE_ENUM        0x55
+
+static inline uint32_t token_of(int table, uint32_t row)
+{
+    return ((uint32_t)table << 24) | row;
+}
+
+static const char * heap_string(struct Context * context, uint32_t index)
+{
+    return (index < context->stringHeap.size) ? context->stringHeap.ptr + index : "";
+}
+
+static inline int valid_token(struct Context * context, uint32_t token)
+{
+    uint32_t table = token >> 24, row = token & 0xFFFFFF;
+    return table < 64 && row > 0 && row <= context->tables[table].rowCount;
+}
+
+int clr_find_attributes(struct Context * context, uint32_t ctor, uint32_t * rows, int max)
+{
+    struct RowRange range;
+    if (clr_lookup_owned(context, CustomAttribute, CustomAttributeColumns::c_Type, ctor >> 24, ctor & 0xFFFFFF, &range) != 0) {
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < range.count && (int)i < max; i++) {
+        rows[i] = row_range_at(&range, i);
+    }
+    return range.count;
+}
+
+struct RowList {
+    uint32_t * rows;
+    int count;
+    int size;
+};
+
+static void add_rows(struct Context * context, uint32_t ctor, struct RowList * list)
+{
+    struct RowRange range;
+    if (clr_lookup_owned(context, CustomAttribute, CustomAttributeColumns::c_Type, ctor >> 24, ctor & 0xFFFFFF, &range) != 0) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < range.count; i++) {
+        if (list->count >= list->size) {
+            list->size = list->size ? list->size * 2 : 64;
+            list->rows = (uint32_t*)realloc(list->rows, sizeof(uint32_t) * list->size);
+        }
+        list->rows[list->count++] = row_range_at(&range, i);
+    }
+}
+
+int clr_find_attributes_by_type(struct Context * context, const char * fullName, uint32_t * rows, int max)
+{
+    struct RowList list = { 0, 0, 0 };
+
+    uint32_t type = clr_find_type(context, TypeDef, fullName);
+    if (type) {
+        uint32_t first, count;
+        clr_member_range(context, MethodDef, type, &first, &count);
+        for (uint32_t row = first; row < first + count; row++) {
+            if (strcmp(heap_string(context, Row<MethodDef>(context->tables, row - 1).Name()), ".ctor") == 0) {
+                add_rows(context, token_of(MethodDef, row), &list);
+            }
+        }
+    }
+
+    uint32_t ref = clr_find_type(context, TypeRef, fullName);
+    struct RowRange range;
+    if (ref && clr_lookup_owned(context, MemberRef, MemberRefColumns::c_Class, TypeRef, ref, &range) == 0) {
+        for (uint32_t i = 0; i < range.count; i++) {
+            uint32_t row = row_range_at(&range, i);
+            if (strcmp(heap_string(context, Row<MemberRef>(context->tables, row - 1).Name()), ".ctor") == 0) {
+                add_rows(context, token_of(MemberRef, row), &list);
+            }
+        }
+    }
+
+    std::sort(list.rows, list.rows + list.count);
+
+    for (int i = 0; i < list.count && i < max; i++) {
+        rows[i] = list.rows[i];
+    }
+
+    free(list.rows);
+    return list.count;
+}
+
+uint32_t clr_attribute_owner(struct Context * context, uint32_t row)
+{
+    if (row == 0 || row > context->tables[CustomAttribute].rowCount) {
+        return 0;
+    }
+
+    int table;
+    uint32_t parent = Row<CustomAttribute>(context->tables, row - 1).Parent(&table);
+    return parent ? token_of(table, parent) : 0;
+}
+
+uint32_t clr_attribute_ctor(struct Context * context, uint32_t row)
+{
+    if (row == 0 || row > context->tables[CustomAttribute].rowCount) {
+        return 0;
+    }
+
+    int table;
+    uint32_t ctor = Row<CustomAttribute>(context->tables, row - 1).Type(&table);
+    return ctor ? token_of(table, ctor) : 0;
+}
+
+uint32_t clr_attribute_type(struct Context * context, uint32_t ctor)
+{
+    if (!valid_token(context, ctor)) {
+        return 0;
+    }
+
+    uint32_t row = ctor & 0xFFFFFF;
+    switch(ctor >> 24) {
+        case MethodDef: {
+            uint32_t type = clr_member_owner(context, MethodDef, row);
+            return type ? token_of(TypeDef, type) : 0;
+        }
+        case MemberRef: {
+            int table;
+            uint32_t parent = Row<MemberRef>(context->tables, row - 1).Class(&table);
+            if (table == TypeDef || table == TypeRef) {
+                return token_of(table, parent);
+            }
+
+            // a generic attribute, its TypeSpec instantiates the type
+            const struct Signature * spec = (table == TypeSpec) ? clr_row_signature(context, TypeSpec, parent) : 0;
+            if (spec && spec->type->element == ELEMENT_TYPE_GENERICINST) {
+                return spec->type->inner->token;
+            }
+            return 0;
+        }
+        default:
+            return 0;
+    }
+}
+
+static int type_is(struct Context * context, uint32_t token, const char * fullName)
+{
+    char name[ATTRIBUTE_NAME_MAX];
+    return valid_token(context, token)
+        && clr_type_name(context, token >> 24, token & 0xFFFFFF, name, sizeof(name)) >= 0
+        && strcmp(name, fullName) == 0;
+}
+
+int clr_has_attribute(struct Context * context, uint32_t owner, const char * fullName)
+{
+    struct RowRange range;
+    if (clr_lookup_owned(context, CustomAttribute, CustomAttributeColumns::c_Parent, owner >> 24, owner & 0xFFFFFF, &range) != 0) {
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < range.count; i++) {
+        uint32_t ctor = clr_attribute_ctor(context, row_range_at(&range, i));
+        if (type_is(context, clr_attribute_type(context, ctor), fullName)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// value blobs
+
+// values by CustomAttribute row, filled when first asked for. hits read
+// without the lock, decoding holds it for the arena.
+struct AttributeCache {
+    pthread_mutex_t lock;
+    struct Arena arena;
+    EnumResolver resolver;
+    void * resolverArg;
+    const struct AttributeValue * values[];
+};
+
+// remembered for blobs that do not decode, so they are not tried again
+static const struct AttributeValue malformed = { 0, 0, 0, 0 };
+
+// what a value is encoded as: a primitive, STRING, SZARRAY of elem, a
+// System.Type or a boxed value; enums carry their underlying type
+struct ValueType {
+    uint8_t element;
+    uint8_t isEnum;
+    uint8_t elem;           // SZARRAY
+    uint8_t elemIsEnum;
+    const char * enumType;  // named arguments
+};
+
+struct ValueReader {
+    struct Context * context;
+    struct Arena * arena;
+    const struct AttributeCache * cache;
+    const char * ptr;
+    const char * end;
+};
+
+static int read_bytes(struct ValueReader * reader, void * out, size_t n)
+{
+    if ((size_t)(reader->end - reader->ptr) < n) {
+        return -1;
+    }
+    memcpy(out, reader->ptr, n);
+    reader->ptr += n;
+    return 0;
+}
+
+// SerString: 0xFF for null, else a compressed length and UTF-8
+static int read_string(struct ValueReader * reader, const char ** str, uint32_t * len)
+{
+    if (reader->ptr < reader->end && (uint8_t)*reader->ptr == 0xFF) {
+        reader->ptr++;
+        *str = 0;
+        *len = 0;
+        return 0;
+    }
+
+    const char * ptr = read_compressed(reader->ptr, reader->end, len);
+    if (ptr == 0 || *len > (uint32_t)(reader->end - ptr)) {
+        return -1;
+    }
+
+    char * copy = (char*)arena_alloc(reader->arena, *len + 1);
+    memcpy(copy, ptr, *len);
+    *str = copy;
+    reader->ptr = ptr + *len;
+    return 0;
+}
+
+static int value_size(int element)
+{
+    switch(element) {
+        case ELEMENT_TYPE_BOOLEAN:
+        case ELEMENT_TYPE_I1:
+        case ELEMENT_TYPE_U1:       return 1;
+        case ELEMENT_TYPE_CHAR:
+        case ELEMENT_TYPE_I2:
+        case ELEMENT_TYPE_U2:       return 2;
+        case ELEMENT_TYPE_I4:
+        case ELEMENT_TYPE_U4:
+        case ELEMENT_TYPE_R4:       return 4;
+        case ELEMENT_TYPE_I8:
+        case ELEMENT_TYPE_U8:
+        case ELEMENT_TYPE_R8:       return 8;
+        default:                    return 0;
+    }
+}
+
+int clr_enum_underlying(struct Context * context, uint32_t typeDef)
+{
+    uint32_t field = clr_find_type_member(context, Field, typeDef, "value__");
+    const struct Signature * sig = field ? clr_row_signature(context, Field, field) : 0;
+    return (sig && value_size(sig->type->element) > 0) ? sig->type->element : 0;
+}
+
+static int resolve_enum(struct ValueReader * reader, uint32_t typeRef, const char * name)
+{
+    int element = 0;
+    if (reader->cache->resolver) {
+        element = reader->cache->resolver(reader->cache->resolverArg, reader->context, typeRef, name);
+    }
+    return (value_size(element) > 0) ? element : ELEMENT_TYPE_I4;
+}
+
+static int enum_underlying_by_token(struct ValueReader * reader, uint32_t token)
+{
+    int element = 0;
+    if ((token >> 24) == TypeDef) {
+        element = clr_enum_underlying(reader->context, token & 0xFFFFFF);
+    } else if ((token >> 24) == TypeRef) {
+        return resolve_enum(reader, token, 0);
+    }
+    return element ? element : ELEMENT_TYPE_I4;
+}
+
+// named arguments name enums as reflection does, "Ns.Outer+Inner" and
+// maybe the assembly after a comma
+static int enum_underlying_by_name(struct ValueReader * reader, const char * name)
+{
+    char buf[ATTRIBUTE_NAME_MAX];
+    size_t len = strcspn(name, ",");
+    if (len < sizeof(buf)) {
+        for (size_t i = 0; i < len; i++) {
+            buf[i] = (name[i] == '+') ? '/' : name[i];
+        }
+        buf[len] = 0;
+
+        uint32_t row = clr_find_type(reader->context, TypeDef, buf);
+        int element = row ? clr_enum_underlying(reader->context, row) : 0;
+        if (element) {
+            return element;
+        }
+    }
+
+    return resolve_enum(reader, 0, name);
+}
+
+// a parameter type of the constructor signature
+static int sig_value_type(struct ValueReader * reader, const struct SigType * sig, uint8_t * element, uint8_t * isEnum)
+{
+    *isEnum = 0;
+
+    switch(sig->element) {
+        case ELEMENT_TYPE_STRING:
+        case ELEMENT_TYPE_OBJECT:
+            *element = (sig->element == ELEMENT_TYPE_OBJECT) ? ATTRIBUTE_TYPE_BOXED : ELEMENT_TYPE_STRING;
+            return 0;
+        case ELEMENT_TYPE_CLASS:
+            if (!type_is(reader->context, sig->token, "System.Type")) {
+                return -1;
+            }
+            *element = ATTRIBUTE_TYPE_SYSTEM_TYPE;
+            return 0;
+        case ELEMENT_TYPE_VALUETYPE:
+            *element = enum_underlying_by_token(reader, sig->token);
+            *isEnum = 1;
+            return 0;
+        default:
+            if (value_size(sig->element) == 0) {
+                return -1;
+            }
+            *element = sig->element;
+            return 0;
+    }
+}
+
+static int fixed_type(struct ValueReader * reader, const struct SigType * sig, struct ValueType * type)
+{
+    memset(type, 0, sizeof(struct ValueType));
+
+    if (sig->element == ELEMENT_TYPE_SZARRAY) {
+        type->element = ELEMENT_TYPE_SZARRAY;
+        return sig_value_type(reader, sig->inner, &type->elem, &type->elemIsEnum);
+    }
+
+    return sig_value_type(reader, sig, &type->element, &type->isEnum);
+}
+
+// FieldOrPropType of a named argument or boxed value
+static int read_encoded_type(struct ValueReader * reader, struct ValueType * type)
+{
+    memset(type, 0, sizeof(struct ValueType));
+
+    uint8_t tag;
+    if (read_bytes(reader, &tag, 1) != 0) {
+        return -1;
+    }
+
+    uint8_t * element = &type->element;
+    uint8_t * isEnum = &type->isEnum;
+    if (tag == ELEMENT_TYPE_SZARRAY) {
+        type->element = ELEMENT_TYPE_SZARRAY;
+        element = &type->elem;
+        isEnum = &type->elemIsEnum;
+        if (read_bytes(reader, &tag, 1) != 0) {
+            return -1;
+        }
+    }
+
+    if (tag == ATTRIBUTE_TYPE_ENUM) {
+        uint32_t len;
+        if (read_string(reader, &type->enumType, &len) != 0 || type->enumType == 0) {
+            return -1;
+        }
+        *element = enum_underlying_by_name(reader, type->enumType);
+        *isEnum = 1;
+        return 0;
+    }
+
+    if (tag != ELEMENT_TYPE_STRING && tag != ATTRIBUTE_TYPE_SYSTEM_TYPE && tag != ATTRIBUTE_TYPE_BOXED && value_size(tag) == 0) {
+        return -1;
+    }
+
+    *element = tag;
+    return 0;
+}
+
+static int read_scalar(struct ValueReader * reader, int element, int isEnum, struct AttributeElem * out);
+
+static int read_value(struct ValueReader * reader, const struct ValueType * type, struct AttributeElem * out)
+{
+    if (type->element != ELEMENT_TYPE_SZARRAY) {
+        // a boxed value names its own enum in the nested read
+        int ret = read_scalar(reader, type->element, type->isEnum, out);
+        if (type->isEnum) {
+            out->enumType = type->enumType;
+        }
+        return ret;
+    }
+
+    out->type = ELEMENT_TYPE_SZARRAY;
+
+    uint32_t count;
+    if (read_bytes(reader, &count, 4) != 0) {
+        return -1;
+    }
+
+    if (count == 0xFFFFFFFF) {
+        out->isNull = 1;
+        return 0;
+    }
+
+    // every element takes a byte or more
+    if (count > (uint32_t)(reader->end - reader->ptr)) {
+        return -1;
+    }
+
+    struct AttributeElem * elems = (struct AttributeElem*)arena_alloc(reader->arena, sizeof(struct AttributeElem) * (count ? count : 1));
+    for (uint32_t i = 0; i < count; i++) {
+        if (read_scalar(reader, type->elem, type->elemIsEnum, elems + i) != 0) {
+            return -1;
+        }
+        if (type->elemIsEnum) {
+            elems[i].enumType = type->enumType;
+        }
+    }
+
+    out->count = count;
+    out->elems = elems;
+    return 0;
+}
+
+static int read_scalar(struct ValueReader * reader, int element, int isEnum, struct AttributeElem * out)
+{
+    switch(element) {
+        case ELEMENT_TYPE_STRING:
+        case ATTRIBUTE_TYPE_SYSTEM_TYPE:
+            out->type = ELEMENT_TYPE_STRING;
+            out->isType = (element == ATTRIBUTE_TYPE_SYSTEM_TYPE);
+            if (read_string(reader, &out->str, &out->len) != 0) {
+                return -1;
+            }
+            out->isNull = (out->str == 0);
+            return 0;
+        case ATTRIBUTE_TYPE_BOXED: {
+            // a boxed value is preceded by its own type, which may not
+            // itself be boxed
+            struct ValueType type;
+            if (read_encoded_type(reader, &type) != 0 || type.element == ATTRIBUTE_TYPE_BOXED || type.elem == ATTRIBUTE_TYPE_BOXED) {
+                return -1;
+            }
+            return read_value(reader, &type, out);
+        }
+        default:
+            break;
+    }
+
+    int size = value_size(element);
+    if (size == 0) {
+        return -1;
+    }
+
+    out->type = element;
+    out->isEnum = isEnum;
+
+    union { uint8_t u8; uint16_t u16; uint32_t u32; uint64_t u64; int8_t i8; int16_t i16; int32_t i32; float r4; double r8; } raw;
+    if (read_bytes(reader, &raw, size) != 0) {
+        return -1;
+    }
+
+    switch(element) {
+        case ELEMENT_TYPE_BOOLEAN:
+        case ELEMENT_TYPE_U1:   out->u = raw.u8; break;
+        case ELEMENT_TYPE_I1:   out->i = raw.i8; break;
+        case ELEMENT_TYPE_CHAR:
+        case ELEMENT_TYPE_U2:   out->u = raw.u16; break;
+        case ELEMENT_TYPE_I2:   out->i = raw.i16; break;
+        case ELEMENT_TYPE_U4:   out->u = raw.u32; break;
+        case ELEMENT_TYPE_I4:   out->i = raw.i32; break;
+        case ELEMENT_TYPE_R4:   out->r = raw.r4; break;
+        case ELEMENT_TYPE_R8:   out->r = raw.r8; break;
+        default:                out->u = raw.u64; break;
+    }
+    return 0;
+}
+
+static const struct AttributeValue * decode(struct Context * context, struct AttributeCache * cache, uint32_t row)
+{
+    Row<CustomAttribute> attribute(context->tables, row - 1);
+
+    int table;
+    uint32_t ctor = attribute.Type(&table);
+    const struct Signature * sig = clr_row_signature(context, table, ctor);
+    if (sig == 0 || sig->kind != Sig_Method) {
+        return 0;
+    }
+
+    uint32_t len;
+    const char * ptr = clr_get_blob(context, attribute.Value(), &len);
+    struct Arena * arena = &cache->arena;
+    struct ValueReader reader = { context, arena, cache, ptr, ptr + len };
+
+    uint16_t prolog;
+    if (ptr == 0 || read_bytes(&reader, &prolog, 2) != 0 || prolog != 0x0001) {
+        return 0;
+    }
+
+    struct AttributeArg * fixed = (struct AttributeArg*)arena_alloc(arena, sizeof(struct AttributeArg) * (sig->count ? sig->count : 1));
+    for (uint32_t i = 0; i < sig->count; i++) {
+        struct ValueType type;
+        fixed[i].kind = ATTRIBUTE_ARG_FIXED;
+        if (fixed_type(&reader, sig->types[i], &type) != 0 || read_value(&reader, &type, &fixed[i].value) != 0) {
+            return 0;
+        }
+    }
+
+    uint16_t named;
+    if (read_bytes(&reader, &named, 2) != 0) {
+        return 0;
+    }
+
+    struct AttributeArg * args = fixed;
+    if (named) {
+        args = (struct AttributeArg*)arena_alloc(arena, sizeof(struct AttributeArg) * (sig->count + named));
+        memcpy(args, fixed, sizeof(struct AttributeArg) * sig->count);
+    }
+
+    for (uint32_t i = sig->count; i < sig->count + named; i++) {
+        struct ValueType type;
+        uint32_t nameLen;
+        if (read_bytes(&reader, &args[i].kind, 1) != 0
+                || (args[i].kind != ATTRIBUTE_ARG_FIELD && args[i].kind != ATTRIBUTE_ARG_PROPERTY)
+                || read_encoded_type(&reader, &type) != 0
+                || read_string(&reader, &args[i].name, &nameLen) != 0 || args[i].name == 0
+                || read_value(&reader, &type, &args[i].value) != 0) {
+            return 0;
+        }
+    }
+
+    struct AttributeValue * value = (struct AttributeValue*)arena_alloc(arena, sizeof(struct AttributeValue));
+    value->ctor = token_of(table, ctor);
+    value->fixedCount = sig->count;
+    value->count = sig->count + named;
+    value->args = args;
+    return value;
+}
+
+static struct AttributeCache * get_cache(struct Context * context)
+{
+    struct AttributeCache * cache = __atomic_load_n(&context->attributes, __ATOMIC_ACQUIRE);
+    if (cache == 0) {
+        uint32_t count = context->tables[CustomAttribute].rowCount + 1;
+        struct AttributeCache * fresh = (struct AttributeCache*)calloc(1, sizeof(struct AttributeCache) + sizeof(void*) * count);
+        pthread_mutex_init(&fresh->lock, 0);
+        arena_init(&fresh->arena, ATTRIBUTE_ARENA_CHUNK);
+
+        // concurrent first users may both build, the loser frees its copy
+        if (__atomic_compare_exchange_n(&context->attributes, &cache, fresh, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            cache = fresh;
+        } else {
+            pthread_mutex_destroy(&fresh->lock);
+            free(fresh);
+        }
+    }
+    return cache;
+}
+
+const struct AttributeValue * clr_attribute_value(struct Context * context, uint32_t row)
+{
+    if (row == 0 || row > context->tables[CustomAttribute].rowCount) {
+        return 0;
+    }
+
+    struct AttributeCache * cache = get_cache(context);
+    const struct AttributeValue * value = __atomic_load_n(&cache->values[row], __ATOMIC_ACQUIRE);
+
+    if (value == 0) {
+        pthread_mutex_lock(&cache->lock);
+
+        value = cache->values[row];
+        if (value == 0) {
+            // what a failed decode allocated stays in the arena
+            value = decode(context, cache, row);
+            if (value == 0) {
+                value = &malformed;
+            }
+            __atomic_store_n(&cache->values[row], value, __ATOMIC_RELEASE);
+        }
+
+        pthread_mutex_unlock(&cache->lock);
+    }
+
+    return (value == &malformed) ? 0 : value;
+}
+
+void clr_set_enum_resolver(struct Context * context, EnumResolver resolver, void * arg)
+{
+    struct AttributeCache * cache = get_cache(context);
+
+    pthread_mutex_lock(&cache->lock);
+    cache->resolver = resolver;
+    cache->resolverArg = arg;
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void attribute_free(struct Context * context)
+{
+    struct AttributeCache * cache = context->attributes;
+    if (cache == 0) {
+        return;
+    }
+
+    arena_free(&cache->arena);
+    pthread_mutex_destroy(&cache->lock);
+    free(cache);
+    context->attributes = 0;
+}
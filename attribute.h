@@ -0,0 +1,89 @@
+#ifndef _CLRPARSER_ATTRIBUTE_H_
+#define _CLRPARSER_ATTRIBUTE_H_
+
+#include <stdint.h>
+
+#include "clr.h"
+
+// custom attributes by constructor and by attribute type, on top of the
+// row indexes of lookup.h: CustomAttribute.Type for the constructor,
+// MemberRef.Class for the constructors of a referenced attribute type.
+// tokens are table << 24 | row.
+
+// CustomAttribute rows whose constructor is the given MethodDef or
+// MemberRef token. up to max rows are stored, the number found is returned.
+int clr_find_attributes(struct Context * context, uint32_t ctor, uint32_t * rows, int max);
+
+// the same for every constructor of the attribute type named fullName
+// ("System.ObsoleteAttribute"), defined or referenced by this assembly.
+// rows are in table order.
+int clr_find_attributes_by_type(struct Context * context, const char * fullName, uint32_t * rows, int max);
+
+// whether the owner token carries an attribute of the type named fullName
+int clr_has_attribute(struct Context * context, uint32_t owner, const char * fullName);
+
+// owner (Parent) and constructor (Type) of a CustomAttribute row
+uint32_t clr_attribute_owner(struct Context * context, uint32_t row);
+uint32_t clr_attribute_ctor(struct Context * context, uint32_t row);
+
+// TypeDef or TypeRef token of the type declaring a constructor token, 0
+// if it can not be told
+uint32_t clr_attribute_type(struct Context * context, uint32_t ctor);
+
+// ECMA-335 II.23.3 value blob, decoded when first asked for and kept until
+// close_clr.
+
+#define ATTRIBUTE_ARG_FIXED    0
+#define ATTRIBUTE_ARG_FIELD    0x53
+#define ATTRIBUTE_ARG_PROPERTY 0x54
+
+struct AttributeElem {
+    uint8_t type;           // ElementType of the value, also of a boxed one; STRING for a System.Type
+    uint8_t isNull;         // null string, type or array
+    uint8_t isEnum;         // type is the underlying type of an enum
+    uint8_t isType;         // a System.Type, its name is in str
+    union {
+        int64_t i;          // BOOLEAN, CHAR, I1 .. I8, enums
+        uint64_t u;         // U1 .. U8
+        double r;           // R4, R8
+    };
+    const char * str;       // STRING, NUL terminated
+    uint32_t len;
+    uint32_t count;         // SZARRAY elements
+    const struct AttributeElem * elems;
+    const char * enumType;  // named enum arguments, the type as written; 0 otherwise
+};
+
+struct AttributeArg {
+    uint8_t kind;           // ATTRIBUTE_ARG_*
+    const char * name;      // field or property name, 0 for fixed arguments
+    struct AttributeElem value;
+};
+
+struct AttributeValue {
+    uint32_t ctor;
+    uint32_t fixedCount;    // fixed arguments come first in args
+    uint32_t count;
+    const struct AttributeArg * args;
+};
+
+// the decoded value of a CustomAttribute row, 0 if the blob is malformed.
+// the underlying type of enums defined in this assembly is read from their
+// value__ field, that of other enums comes from the enum resolver and is
+// taken to be int32 if there is none.
+const struct AttributeValue * clr_attribute_value(struct Context * context, uint32_t row);
+
+// underlying ElementType of an enum TypeDef row, from its value__ field;
+// 0 if it has none
+int clr_enum_underlying(struct Context * context, uint32_t typeDef);
+
+// underlying ElementType of an enum this assembly does not define, given
+// the TypeRef token of a fixed argument, or 0 and the reflection name of
+// a named argument ("Ns.Outer+Inner, Assembly, Version=..."); 0 if unknown.
+// set before the first clr_attribute_value, see workspace_resolve_enums.
+typedef int (*EnumResolver)(void * arg, struct Context * context, uint32_t typeRef, const char * name);
+void clr_set_enum_resolver(struct Context * context, EnumResolver resolver, void * arg);
+
+void attribute_free(struct Context * context);
+
+#endif
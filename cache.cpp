@@ -0,0 +1,311 @@
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "cache.h"
+#include "clr.h"
+#include "pe.h"
+#include "clr_header.h"
+
+#define CACHE_MAGIC   0x43524C43 // CLRC
+#define CACHE_VERSION 3
+
+// a writer renames its temp file within moments, one this old was left
+// behind by a crash
+#define CACHE_TMP_AGE 600
+
+#pragma pack(push, 1)
+struct CacheRecord {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t key;
+	uint32_t size;     // sizeof(struct ClrLayout)
+	uint32_t checksum; // of layout
+	struct ClrLayout layout;
+};
+#pragma pack(pop)
+
+static uint64_t fnv1a(uint64_t hash, const void * ptr, size_t len)
+{
+	const unsigned char * p = (const unsigned char*)ptr;
+	for (size_t i = 0; i < len; i++) {
+		hash ^= p[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+static int cache_key(struct PEFile * file, uint64_t * key)
+{
+	uint64_t NumberOfRvaAndSizes = 0;
+	if (file->OptionalHeaderWindowsSpecificFields_PE32 != 0) {
+		NumberOfRvaAndSizes = file->OptionalHeaderWindowsSpecificFields_PE32->NumberOfRvaAndSizes;
+	} else if (file->OptionalHeaderWindowsSpecificFields_PE32Plus != 0) {
+		NumberOfRvaAndSizes = file->OptionalHeaderWindowsSpecificFields_PE32Plus->NumberOfRvaAndSizes;
+	}
+
+	if (NumberOfRvaAndSizes < 15) {
+		return -1;
+	}
+
+	const struct TCLRHeader * CLRHeader = (const struct TCLRHeader*)find_virtual_range(file, file->IMAGE_DATA_DIRECTORY[14].VirtualAddress, sizeof(struct TCLRHeader));
+	if (CLRHeader == 0) {
+		return -1;
+	}
+
+	// the metadata root, the stream headers and the table stream header
+	// with its row counts normally all sit in the first few hundred bytes
+	size_t head = CLRHeader->MetaDataSize < 4096 ? CLRHeader->MetaDataSize : 4096;
+	const char * metadata = find_virtual_range(file, CLRHeader->MetaDataVirtualAddress, head);
+	if (metadata == 0) {
+		return -1;
+	}
+
+	uint64_t size = file->size;
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	hash = fnv1a(hash, &size, sizeof(size));
+	hash = fnv1a(hash, &file->COFFFileHeader->TimeDateStamp, sizeof(uint32_t));
+	hash = fnv1a(hash, CLRHeader, sizeof(struct TCLRHeader));
+	hash = fnv1a(hash, metadata, head);
+
+	*key = hash;
+	return 0;
+}
+
+static void cache_path(char * path, size_t len, const char * dir, uint64_t key)
+{
+	snprintf(path, len, "%s/%016lx.clrc", dir, (unsigned long)key);
+}
+
+static int cache_load(const char * dir, uint64_t key, struct ClrLayout * layout)
+{
+	char path[4096];
+	cache_path(path, sizeof(path), dir, key);
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return -1;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size != sizeof(struct CacheRecord)) {
+		close(fd);
+		return -1;
+	}
+
+	void * ptr = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (ptr == MAP_FAILED) {
+		close(fd);
+		return -1;
+	}
+
+	const struct CacheRecord * record = (const struct CacheRecord*)ptr;
+
+	int ret = -1;
+	if (record->magic == CACHE_MAGIC && record->version == CACHE_VERSION && record->key == key && record->size == sizeof(struct ClrLayout)
+		&& record->checksum == (uint32_t)fnv1a(0xcbf29ce484222325ULL, &record->layout, sizeof(struct ClrLayout))) {
+		memcpy(layout, &record->layout, sizeof(struct ClrLayout));
+		ret = 0;
+	}
+
+	munmap(ptr, st.st_size);
+
+	// mtime is the LRU clock, only bump it once a minute to keep hits read-only
+	if (ret == 0 && st.st_mtime + 60 < time(0)) {
+		futimens(fd, 0);
+	}
+
+	close(fd);
+	return ret;
+}
+
+struct CacheFile {
+	char name[64];
+	time_t mtime;
+	off_t size;
+};
+
+static int compare_cache_file(const void * a, const void * b)
+{
+	time_t ta = ((const struct CacheFile*)a)->mtime;
+	time_t tb = ((const struct CacheFile*)b)->mtime;
+	return (ta > tb) - (ta < tb);
+}
+
+static int has_suffix(const char * name, size_t len, const char * suffix)
+{
+	size_t n = strlen(suffix);
+	return len >= n && strcmp(name + len - n, suffix) == 0;
+}
+
+// sizes every record in dir and, when they add up to more than limit,
+// removes the oldest. temp files of writers still in flight count towards
+// the size, stale ones are removed. returns the bytes left. called with
+// the lock held.
+static uint64_t cache_evict(const char * dir, uint64_t limit)
+{
+	char path[4096];
+
+	DIR * d = opendir(dir);
+	if (d == 0) {
+		return 0;
+	}
+
+	struct CacheFile * files = 0;
+	int count = 0, size = 0;
+	uint64_t total = 0;
+	time_t cutoff = time(0) - CACHE_TMP_AGE;
+
+	struct dirent * ent;
+	while ((ent = readdir(d)) != 0) {
+		size_t len = strlen(ent->d_name);
+		int tmp = ent->d_name[0] == '.' && has_suffix(ent->d_name, len, ".tmp");
+		if (!tmp && (len >= sizeof(files->name) || !has_suffix(ent->d_name, len, ".clrc"))) {
+			continue;
+		}
+
+		struct stat st;
+		snprintf(path, sizeof(path), "%s/%s", dir, ent->d_name);
+		if (stat(path, &st) != 0) {
+			continue;
+		}
+
+		if (tmp) {
+			if (st.st_mtime >= cutoff) {
+				total += st.st_size;
+			} else if (unlink(path) != 0 && errno != ENOENT) {
+				total += st.st_size;
+			}
+			continue;
+		}
+
+		if (count >= size) {
+			size = size ? size * 2 : 256;
+			files = (struct CacheFile*)realloc(files, sizeof(struct CacheFile) * size);
+		}
+
+		struct CacheFile * file = files + count++;
+		strcpy(file->name, ent->d_name);
+		file->mtime = st.st_mtime;
+		file->size = st.st_size;
+		total += st.st_size;
+	}
+	closedir(d);
+
+	if (total > limit) {
+		qsort(files, count, sizeof(struct CacheFile), compare_cache_file);
+
+		// trim to 90% so the next few stores don't evict again
+		uint64_t target = limit / 10 * 9;
+		for (int i = 0; i < count && total > target; i++) {
+			snprintf(path, sizeof(path), "%s/%s", dir, files[i].name);
+			if (unlink(path) == 0 || errno == ENOENT) {
+				total -= files[i].size;
+			}
+		}
+	}
+
+	free(files);
+	return total;
+}
+
+// adds a stored record to the running size of the directory, kept in
+// .lock, and only scans the directory when that passes limit or is not
+// known yet. replaced records are counted twice; that errs towards an
+// early scan, which recounts exactly.
+static void cache_account(const char * dir, uint64_t bytes, uint64_t limit)
+{
+	char path[4096];
+	snprintf(path, sizeof(path), "%s/.lock", dir);
+
+	int lock = open(path, O_RDWR | O_CREAT, 0644);
+	if (lock < 0) {
+		return;
+	}
+
+	if (flock(lock, LOCK_EX) != 0) {
+		close(lock);
+		return;
+	}
+
+	uint64_t total = 0;
+	if (pread(lock, &total, sizeof(total), 0) != sizeof(total) || total + bytes > limit) {
+		total = cache_evict(dir, limit);
+	} else {
+		total += bytes;
+	}
+
+	if (pwrite(lock, &total, sizeof(total), 0) != sizeof(total)) {
+		ftruncate(lock, 0);
+	}
+
+	flock(lock, LOCK_UN);
+	close(lock);
+}
+
+static void cache_store(const char * dir, uint64_t key, const struct ClrLayout * layout, uint64_t limit)
+{
+	struct CacheRecord record;
+	memset(&record, 0, sizeof(record));
+	record.magic = CACHE_MAGIC;
+	record.version = CACHE_VERSION;
+	record.key = key;
+	record.size = sizeof(struct ClrLayout);
+	memcpy(&record.layout, layout, sizeof(struct ClrLayout));
+	record.checksum = (uint32_t)fnv1a(0xcbf29ce484222325ULL, &record.layout, sizeof(struct ClrLayout));
+
+	static int sequence = 0;
+	int seq = __atomic_fetch_add(&sequence, 1, __ATOMIC_RELAXED);
+
+	char tmp[4096], path[4096];
+	snprintf(tmp, sizeof(tmp), "%s/.%016lx.%d.%d.tmp", dir, (unsigned long)key, (int)getpid(), seq);
+	cache_path(path, sizeof(path), dir, key);
+
+	int fd = open(tmp, O_WRONLY | O_CREAT | O_EXCL, 0644);
+	if (fd < 0) {
+		return;
+	}
+
+	ssize_t n = write(fd, &record, sizeof(record));
+	close(fd);
+
+	if (n != sizeof(record) || rename(tmp, path) != 0) {
+		unlink(tmp);
+		return;
+	}
+
+	cache_account(dir, sizeof(record), limit);
+}
+
+int read_clr_cached(struct Context * context, struct PEFile * file, const char * dir, uint64_t limit)
+{
+	uint64_t key;
+	if (dir == 0 || cache_key(file, &key) != 0) {
+		return read_clr(context, file);
+	}
+
+	struct ClrLayout layout;
+	if (cache_load(dir, key, &layout) == 0 && read_clr_layout(context, file, &layout) == 0) {
+		return 0;
+	}
+
+	if (read_clr(context, file) != 0) {
+		return -1;
+	}
+
+	clr_get_layout(context, &layout);
+	cache_store(dir, key, &layout, limit);
+
+	return 0;
+}
@@ -0,0 +1,20 @@
+#ifndef _CLRPARSER_CACHE_H_
+#define _CLRPARSER_CACHE_H_
+
+#include <stdint.h>
+
+#include "clr.h"
+
+#define CLR_CACHE_DEFAULT_LIMIT (64 * 1024 * 1024)
+
+// read_clr backed by an on-disk cache of ClrLayout records in dir.
+//
+// records are keyed by a hash of the file size, the COFF TimeDateStamp,
+// the CLR header and the head of the metadata root. a hit skips the stream
+// and table schema computation; a miss runs read_clr and stores the result.
+// records are written to a temp file and renamed into place, so several
+// processes can share one directory. once the directory grows beyond limit
+// bytes the least recently used records are removed.
+int read_clr_cached(struct Context * context, struct PEFile * file, const char * dir, uint64_t limit);
+
+#endif
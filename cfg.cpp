@@ -0,0 +1,246 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "cfg.h"
+#include "il.h"
+
+// per code offset, in the scratch arena
+#define OFFSET_INSN   0x1
+#define OFFSET_LEADER 0x2
+
+void cfg_builder_init(struct CFGBuilder * builder)
+{
+    arena_init(&builder->scratch, 64 * 1024);
+}
+
+void cfg_builder_free(struct CFGBuilder * builder)
+{
+    arena_free(&builder->scratch);
+}
+
+static inline int mark_target(uint8_t * marks, uint32_t codeSize, int64_t target)
+{
+    if (target < 0 || target >= codeSize) {
+        return -1;
+    }
+    marks[target] |= OFFSET_LEADER;
+    return 0;
+}
+
+// leaders and instruction starts
+static int find_leaders(const struct ILMethodBody * body, uint8_t * marks)
+{
+    const char * code = body->code;
+    uint32_t codeSize = body->codeSize;
+
+    marks[0] |= OFFSET_LEADER;
+
+    struct ILReader reader;
+    il_reader_init(&reader, code, codeSize);
+
+    struct ILInstruction insn;
+    int ret;
+    while ((ret = il_next(&reader, &insn)) > 0) {
+        marks[insn.offset] |= OFFSET_INSN;
+
+        if (insn.operandKind == InlineBrTarget || insn.operandKind == ShortInlineBrTarget) {
+            if (mark_target(marks, codeSize, il_branch_target(&insn)) != 0) {
+                return -1;
+            }
+        } else if (insn.operandKind == InlineSwitch) {
+            for (uint32_t i = 0; i < insn.operand.count; i++) {
+                if (mark_target(marks, codeSize, il_switch_target(&insn, i)) != 0) {
+                    return -1;
+                }
+            }
+        }
+
+        if (insn.flow == FLOW_COND_BRANCH || !il_falls_through(&insn)) {
+            marks[reader.offset] |= OFFSET_LEADER;
+        }
+    }
+    if (ret < 0) {
+        return -1;
+    }
+
+    struct ILExceptionClause clause;
+    for (uint32_t i = 0; il_method_clause(body, i, &clause) == 0; i++) {
+        marks[clause.tryOffset] |= OFFSET_LEADER;
+        marks[clause.tryOffset + clause.tryLength] |= OFFSET_LEADER;
+        marks[clause.handlerOffset] |= OFFSET_LEADER;
+        marks[clause.handlerOffset + clause.handlerLength] |= OFFSET_LEADER;
+        if (clause.flags & IL_CLAUSE_FILTER) {
+            marks[clause.filterOffset] |= OFFSET_LEADER;
+        }
+    }
+
+    // every leader but the end of the code must start an instruction
+    for (uint32_t i = 0; i < codeSize; i++) {
+        if (marks[i] == OFFSET_LEADER) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+// calls emit(to) for each successor of block b, once per block
+template <typename Emit>
+static void block_successors(const struct CFG * cfg, uint32_t b, const char * code, uint32_t codeSize,
+        const uint32_t * blockOf, uint32_t * seen, Emit emit)
+{
+    const struct CFGBlock * block = cfg->blocks + b;
+
+    struct ILInstruction insn;
+    il_decode(code, codeSize, block->last, &insn);
+
+    // seen holds b + 1 for blocks already emitted from b
+    auto add = [&](uint32_t to) {
+        if (seen[to] != b + 1) {
+            seen[to] = b + 1;
+            emit(to);
+        }
+    };
+
+    if (insn.operandKind == InlineBrTarget || insn.operandKind == ShortInlineBrTarget) {
+        add(blockOf[il_branch_target(&insn)]);
+    } else if (insn.operandKind == InlineSwitch) {
+        for (uint32_t i = 0; i < insn.operand.count; i++) {
+            add(blockOf[il_switch_target(&insn, i)]);
+        }
+    }
+
+    if (block->end < codeSize && il_falls_through(&insn)) {
+        add(b + 1);
+    }
+}
+
+int cfg_build(struct CFGBuilder * builder, const struct ILMethodBody * body, struct Arena * arena, struct CFG * cfg)
+{
+    struct Arena * scratch = &builder->scratch;
+    arena_reset(scratch);
+
+    memset(cfg, 0, sizeof(struct CFG));
+
+    const char * code = body->code;
+    uint32_t codeSize = body->codeSize;
+
+    uint32_t * succStart = (uint32_t*)arena_alloc(arena, sizeof(uint32_t));
+    cfg->succStart = succStart;
+    cfg->predStart = succStart;
+    if (codeSize == 0) {
+        return succStart ? 0 : -1;
+    }
+
+    uint8_t * marks = (uint8_t*)arena_alloc(scratch, codeSize + 1);
+    uint32_t * blockOf = (uint32_t*)arena_alloc(scratch, sizeof(uint32_t) * codeSize);
+    if (marks == 0 || blockOf == 0 || find_leaders(body, marks) != 0) {
+        return -1;
+    }
+
+    uint32_t blockCount = 0;
+    for (uint32_t i = 0; i < codeSize; i++) {
+        blockCount += (marks[i] & OFFSET_LEADER) != 0;
+    }
+
+    struct CFGBlock * blocks = (struct CFGBlock*)arena_alloc(arena, sizeof(struct CFGBlock) * blockCount);
+    if (blocks == 0) {
+        return -1;
+    }
+
+    uint32_t b = 0;
+    for (uint32_t i = 0; i < codeSize; i++) {
+        if (marks[i] & OFFSET_LEADER) {
+            if (b > 0) {
+                blocks[b - 1].end = i;
+            }
+            blocks[b].start = i;
+            b++;
+        }
+        if (marks[i] & OFFSET_INSN) {
+            blocks[b - 1].last = i;
+        }
+        blockOf[i] = b - 1;
+    }
+    blocks[b - 1].end = codeSize;
+    blocks[0].flags |= CFG_BLOCK_ENTRY;
+
+    struct ILExceptionClause clause;
+    for (uint32_t i = 0; il_method_clause(body, i, &clause) == 0; i++) {
+        blocks[blockOf[clause.tryOffset]].flags |= CFG_BLOCK_TRY;
+        blocks[blockOf[clause.handlerOffset]].flags |= CFG_BLOCK_HANDLER;
+        if (clause.flags & IL_CLAUSE_FILTER) {
+            blocks[blockOf[clause.filterOffset]].flags |= CFG_BLOCK_FILTER;
+        }
+    }
+
+    cfg->blockCount = blockCount;
+    cfg->blocks = blocks;
+
+    // count, then fill both directions
+    uint32_t * seen = (uint32_t*)arena_alloc(scratch, sizeof(uint32_t) * blockCount);
+    uint32_t * predCount = (uint32_t*)arena_alloc(scratch, sizeof(uint32_t) * (blockCount + 1));
+    succStart = (uint32_t*)arena_alloc(arena, sizeof(uint32_t) * (blockCount + 1));
+    uint32_t * predStart = (uint32_t*)arena_alloc(arena, sizeof(uint32_t) * (blockCount + 1));
+    if (seen == 0 || predCount == 0 || succStart == 0 || predStart == 0) {
+        return -1;
+    }
+
+    uint32_t edgeCount = 0;
+    for (b = 0; b < blockCount; b++) {
+        succStart[b] = edgeCount;
+        block_successors(cfg, b, code, codeSize, blockOf, seen, [&](uint32_t to) {
+            edgeCount++;
+            predCount[to]++;
+        });
+        if (edgeCount == succStart[b]) {
+            blocks[b].flags |= CFG_BLOCK_EXIT;
+        }
+    }
+    succStart[blockCount] = edgeCount;
+
+    predStart[0] = 0;
+    for (b = 0; b < blockCount; b++) {
+        predStart[b + 1] = predStart[b] + predCount[b];
+        predCount[b] = predStart[b];
+    }
+
+    uint32_t * succ = (uint32_t*)arena_alloc(arena, sizeof(uint32_t) * (edgeCount ? edgeCount : 1));
+    uint32_t * pred = (uint32_t*)arena_alloc(arena, sizeof(uint32_t) * (edgeCount ? edgeCount : 1));
+    if (succ == 0 || pred == 0) {
+        return -1;
+    }
+
+    memset(seen, 0, sizeof(uint32_t) * blockCount);
+    uint32_t edge = 0;
+    for (b = 0; b < blockCount; b++) {
+        block_successors(cfg, b, code, codeSize, blockOf, seen, [&](uint32_t to) {
+            succ[edge++] = to;
+            pred[predCount[to]++] = b;
+        });
+    }
+
+    cfg->edgeCount = edgeCount;
+    cfg->succStart = succStart;
+    cfg->succ = succ;
+    cfg->predStart = predStart;
+    cfg->pred = pred;
+
+    return 0;
+}
+
+int cfg_block_at(const struct CFG * cfg, uint32_t offset)
+{
+    uint32_t lo = 0, hi = cfg->blockCount;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (offset < cfg->blocks[mid].start) {
+            hi = mid;
+        } else if (offset >= cfg->blocks[mid].end) {
+            lo = mid + 1;
+        } else {
+            return mid;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,67 @@
+#ifndef _CLRPARSER_CFG_H_
+#define _CLRPARSER_CFG_H_
+
+#include <stdint.h>
+
+#include "arena.h"
+#include "il_method.h"
+
+// basic blocks of a method body. blocks start at offset 0, at branch and
+// switch targets, after instructions that do not fall through and at the
+// bounds of try blocks, filters and handlers. edges are the normal flow
+// only, exception handling is left to the CFG_BLOCK_* flags.
+//
+// successors and predecessors are flat (CSR) arrays of block indexes:
+// those of block b are succ[succStart[b]] .. succ[succStart[b + 1] - 1],
+// the same for pred.
+
+#define CFG_BLOCK_ENTRY     0x1     // offset 0
+#define CFG_BLOCK_TRY       0x2     // starts a try block
+#define CFG_BLOCK_HANDLER   0x4     // starts a catch, finally or fault handler
+#define CFG_BLOCK_FILTER    0x8     // starts a filter
+#define CFG_BLOCK_EXIT      0x10    // ends in ret, throw, rethrow, jmp or endfinally
+
+struct CFGBlock {
+    uint32_t start;         // code offsets [start, end)
+    uint32_t end;
+    uint32_t last;          // offset of the last instruction
+    uint32_t flags;         // CFG_BLOCK_*
+};
+
+struct CFG {
+    uint32_t blockCount;
+    const struct CFGBlock * blocks;
+
+    uint32_t edgeCount;
+    const uint32_t * succStart; // blockCount + 1 entries
+    const uint32_t * succ;
+    const uint32_t * predStart;
+    const uint32_t * pred;
+};
+
+// scratch memory reused from one method to the next
+struct CFGBuilder {
+    struct Arena scratch;
+};
+
+void cfg_builder_init(struct CFGBuilder * builder);
+void cfg_builder_free(struct CFGBuilder * builder);
+
+// blocks and edges of body, allocated from arena; 0 or -1 if the code
+// does not decode or a branch lands inside an instruction
+int cfg_build(struct CFGBuilder * builder, const struct ILMethodBody * body, struct Arena * arena, struct CFG * cfg);
+
+// index of the block holding offset, -1 if there is none
+int cfg_block_at(const struct CFG * cfg, uint32_t offset);
+
+static inline uint32_t cfg_succ_count(const struct CFG * cfg, uint32_t block)
+{
+    return cfg->succStart[block + 1] - cfg->succStart[block];
+}
+
+static inline uint32_t cfg_pred_count(const struct CFG * cfg, uint32_t block)
+{
+    return cfg->predStart[block + 1] - cfg->predStart[block];
+}
+
+#endif
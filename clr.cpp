@@ -6,18 +6,32 @@
 #include <string.h>
 #include <stdint.h>
 #include <stdarg.h>
+#include <stdlib.h>
+#include <pthread.h>
 
 #include "table.h"
 #include "pe.h"
 #include "clr.h"
 #include "opcode.h"
+#include "il.h"
+#include "il_method.h"
 #include "reader.h"
 
 #include "clr_header.h"
+#include "schema.h"
+#include "lookup.h"
+#include "owner.h"
+#include "symbol.h"
+#include "signature.h"
+#include "userstring.h"
+#include "attribute.h"
+#include "verify.h"
+#include "pool.h"
+#include "output.h"
 
 #define READ_TABLE(NAME, COUNT) struct T##NAME * NAME = (struct T##NAME*)ptr; ptr += sizeof(struct T##NAME) * COUNT;
 
-static void parseMetatable(const char * ptr, size_t size, struct Context * context);
+static int parseMetatable(const char * ptr, size_t size, struct Context * context);
 
 int read_clr(struct Context * context, struct PEFile * file)
 {
@@ -29,20 +43,20 @@ int read_clr(struct Context * context, struct PEFile * file)
 	}
 
 	if (NumberOfRvaAndSizes < 15) {
-		printf("not clr file, NumberOfRvaAndSizes: %d\n", (int)NumberOfRvaAndSizes);
+		fprintf(stderr, "not clr file, NumberOfRvaAndSizes: %d\n", (int)NumberOfRvaAndSizes);
 		return -1;
 	}
 
 	uint64_t CLRRuntimeHeaderVirtualAddress = file->IMAGE_DATA_DIRECTORY[14].VirtualAddress;
 	uint64_t CLRRuntimeHeaderSize = file->IMAGE_DATA_DIRECTORY[14].Size;
 	if (CLRRuntimeHeaderVirtualAddress == 0 || CLRRuntimeHeaderSize == 0) {
-		printf("not clr file, CLRRuntimeHeaderVirtualAddress %lu, CLRRuntimeHeaderSize %lu\n", CLRRuntimeHeaderVirtualAddress, CLRRuntimeHeaderSize);
+		fprintf(stderr, "not clr file, CLRRuntimeHeaderVirtualAddress %lu, CLRRuntimeHeaderSize %lu\n", CLRRuntimeHeaderVirtualAddress, CLRRuntimeHeaderSize);
 		return -1;
 	}
 
-	const char * ptr = find_virtual_addr(file, CLRRuntimeHeaderVirtualAddress);
+	const char * ptr = find_virtual_range(file, CLRRuntimeHeaderVirtualAddress, sizeof(struct TCLRHeader));
 	if (ptr == 0)  {
-		printf("find CLRRuntimeHeader failed\n");
+		fprintf(stderr, "find CLRRuntimeHeader failed\n");
 		return -1;
 	}
 
@@ -52,13 +66,20 @@ int read_clr(struct Context * context, struct PEFile * file)
 	uint32_t MetaDataVirtualAddress = CLRHeader->MetaDataVirtualAddress;
 	uint32_t MetaDataSize = CLRHeader->MetaDataSize;
 
-	ptr = find_virtual_addr(file, MetaDataVirtualAddress);
+	ptr = find_virtual_range(file, MetaDataVirtualAddress, MetaDataSize);
+	if (ptr == 0) {
+		fprintf(stderr, "find metadata failed\n");
+		return -1;
+	}
 
 	const char * ptrStartOfTheMetadataRoot = ptr;
 
 	READ_TABLE(MetadataRoot_P1, 1);
 
-	assert(MetadataRoot_P1->Signature == 0x424A5342);
+	if (MetadataRoot_P1->Signature != 0x424A5342) {
+		fprintf(stderr, "bad metadata signature %08X\n", MetadataRoot_P1->Signature);
+		return -1;
+	}
 
 	// skip Name field
 	uint32_t Length = MetadataRoot_P1->Length;
@@ -70,6 +91,10 @@ int read_clr(struct Context * context, struct PEFile * file)
 
 	memset(context, 0, sizeof(struct Context));
 	context->file = file;
+	context->out = stdout;
+	context->metadata = ptrStartOfTheMetadataRoot;
+	context->MetaDataVirtualAddress = MetaDataVirtualAddress;
+	context->MetaDataSize = MetaDataSize;
 
 	struct Slice tableStreamSlice = {0, 0};
 
@@ -109,8 +134,11 @@ int read_clr(struct Context * context, struct PEFile * file)
 		}
 	}
 
-	if (tableStreamSlice.size > 0) {
-		parseMetatable(tableStreamSlice.ptr, tableStreamSlice.size, context);
+	context->tableStream = tableStreamSlice;
+
+	if (tableStreamSlice.size > 0 && parseMetatable(tableStreamSlice.ptr, tableStreamSlice.size, context) != 0) {
+		fprintf(stderr, "bad metadata table stream\n");
+		return -1;
 	}
 
 	return 0;
@@ -135,113 +163,26 @@ static int is_bit_set(uint64_t value, int n) {
 #define guid_index(type, heapSizes, name) {type,  (heapSizes & 0x02) ? 4 : 2, name}
 #define blob_index(type, heapSizes, name) {type,  (heapSizes & 0x04) ? 4 : 2, name}
 
-enum TableType {
-    Module                 = 0x00,
-    TypeRef                = 0x01,
-    TypeDef                = 0x02,
-    Field                  = 0x04,
-    MethodDef              = 0x06,
-    Param                  = 0x08,
-    InterfaceImpl          = 0x09,
-    MemberRef              = 0x0A,
-    Constant               = 0x0B,
-    CustomAttribute        = 0x0C,
-    FieldMarshal           = 0x0D,
-    DeclSecurity           = 0x0E,
-	ClassLayout            = 0x0F,
-    FieldLayout            = 0x10,
-    StandAloneSig          = 0x11,
-    EventMap               = 0x12,
-    Event                  = 0x14,
-    PropertyMap            = 0x15,
-    Property               = 0x17, MethodSemantics        = 0x18,
-    MethodImpl             = 0x19,
-    ModuleRef              = 0x1A,
-    TypeSpec               = 0x1B,
-    ImplMap                = 0x1C,
-    FieldRVA               = 0x1D,
-    Assembly               = 0x20,
-    AssemblyOS             = 0x22,
-    AssemblyProcesser      = 0x21,
-    AssemblyRef            = 0x23,
-    AssemblyRefProcessor   = 0x24,
-    AssemblyRefOS          = 0x25,
-    File                   = 0x26,
-    ExportedType           = 0x27,
-    ManifestResource       = 0x28,
-    NestedClass            = 0x29,
-    GenericParam           = 0x2A,
-    MethodSpec             = 0x2B,
-    GenericParamConstraint = 0x2C,
-
-    Permission = 0x38, // TODO:
-    NotUsed = 0x39,
-};
+// element lists of the coded indexes, -1 terminated, coded_TypeDefOrRef etc.
+#define CODED(KIND, ...) static const int coded_##KIND [] = {__VA_ARGS__, -1};
+#include "schema.def"
 
-#define HasCustomAttribute \
-    MethodDef, Field, TypeRef, TypeDef, Param, InterfaceImpl, MemberRef, \
-    Module, Permission, Property, Event, StandAloneSig, ModuleRef, TypeSpec, \
-    Assembly, AssemblyRef, File, ExportedType, ManifestResource, \
-    GenericParam, GenericParamConstraint, MethodSpec
-#define TypeDefOrRef        TypeDef, TypeRef, TypeSpec 
-#define HasConstant         Field, Param, Property
-#define HasFieldMarshall    Field, Param
-#define HasDeclSecurity     TypeDef, MethodDef, Assembly
-#define MemberRefParent     TypeDef, TypeRef, ModuleRef, MethodDef, TypeSpec
-#define HasSemantics        Event, Property
-#define MethodDefOrRef      MethodDef, MemberRef
-#define MemberForwarded     Field, MethodDef
-#define Implementation      File, AssemblyRef, ExportedType
-#define CustomAttributeType NotUsed, NotUsed, MethodDef, MemberRef, NotUsed
-#define ResolutionScope     Module, ModuleRef, AssemblyRef, TypeRef
-#define TypeOrMethodDef     TypeDef, MethodDef
+#define CODED(KIND, ...) coded_##KIND,
+static const int * coded_lists [CodedIndex_Count] = {
+#include "schema.def"
+};
 
 static void table_for_each_field(int TYPE, void(*FUNC)(void * ctx, char type, const char * name, const int values []), void * ctx) {
-#define F(Name, Size)        do { int vs [] = {Size}; FUNC(ctx, 'F', Name, vs); } while(0)
-#define S(Name)              FUNC(ctx, 'S', Name, 0)
-#define G(Name)              FUNC(ctx, 'G', Name, 0)
-#define B(Name)              FUNC(ctx, 'B', Name, 0)
-#define I(Name, ...)         do { static int vs [] = {__VA_ARGS__, -1}; FUNC(ctx, 'I', Name, vs); } while(0)
+#define F(Name, Size)        do { static const int vs [] = {Size}; FUNC(ctx, 'F', #Name, vs); } while(0);
+#define S(Name)              FUNC(ctx, 'S', #Name, 0);
+#define G(Name)              FUNC(ctx, 'G', #Name, 0);
+#define B(Name)              FUNC(ctx, 'B', #Name, 0);
+#define T(Name, Table)       do { static const int vs [] = {Table, -1}; FUNC(ctx, 'I', #Name, vs); } while(0);
+#define C(Name, Kind)        FUNC(ctx, 'I', #Name, coded_##Kind);
+#define TABLE(Type, ...)     case Type: __VA_ARGS__ break;
 
 	switch(TYPE) { 
-		case Assembly: F("HashAlgId", 4); F("MajorVersion", 2); F("MinorVersion", 2); F("BuildNumber", 2); F("RevisionNumber", 2); F("Flags", 4); B("PublicKey"); S("Name"); S("Culture"); break; 
-		case AssemblyOS: F("OSPlatformID", 4); F("OSMajorVersion", 4); F("OSMinorVersion", 4); break; 
-		case AssemblyProcesser: F("Processor", 4); break; 
-		case AssemblyRef: F("MajorVersion", 2); F("MinorVersion", 2); F("BuildNumber", 2); F("RevisionNumber", 2); F("Flags", 4); B("PublicKeyOrToken"); S("Name"); S("Culture"); B("HashValue"); break; 
-		case AssemblyRefOS: F("OSPlatformId", 4); F("OSMajorVersion", 4); F("OSMinorVersion", 4); I("AssemblyRef", AssemblyRef); break; 
-		case AssemblyRefProcessor: F("Processor", 4); I("AssemblyRef", AssemblyRef); break; 
-		case ClassLayout: F("PackingSize", 2); F("ClassSize", 4); I("Parent", TypeDef); break; 
-		case Constant: F("Type", 2); I("Parent", HasConstant); B("Value"); break; 
-		case CustomAttribute: I("Parent", HasCustomAttribute); I("Type", CustomAttributeType); B("Value"); break; 
-		case DeclSecurity: F("Action", 2); I("Parent", HasDeclSecurity); B("PermissionSet"); break; 
-		case EventMap: I("Parent", TypeDef); I("EventList", Event); break; 
-		case Event: F("EventFlags", 2); S("Name"); I("EventType", TypeDefOrRef); break; 
-		case ExportedType: F("Flags", 4); F("TypeDefId", 4); S("TypeName"); S("TypeNamespace"); I("Implementation", Implementation); break; 
-		case Field: F("Flags", 2); S("Name"); B("Signature"); break; 
-		case FieldLayout: F("Offset", 4); I("Field", Field); break; 
-		case FieldMarshal: I("Parent", HasFieldMarshall); B("NativeType"); break; 
-		case FieldRVA: F("RVA", 4); I("Field", Field); break; 
-		case File: F("Flags", 4); S("Name"); B("HashValue"); break; 
-		case GenericParam: F("Number", 2); F("Flags", 2); I("Owner", TypeOrMethodDef); S("Name"); break; 
-		case GenericParamConstraint: I("Owner", GenericParam); I("Constraint", TypeDefOrRef); break; 
-		case ImplMap: F("MappingFlags", 2); I("MemberForwarded", MemberForwarded); S("ImportName"); S("ImportScope"); break; 
-		case InterfaceImpl: I("Class", TypeDef); I("Interface", TypeDefOrRef); break; 
-		case ManifestResource: F("Offset",4); F("Flags", 4); S("Name"); I("Implementation", Implementation); break; 
-		case MemberRef: I("Class", MemberRefParent); S("Name"); B("Signature"); break; 
-		case MethodDef: F("RVA", 4); F("ImplFlags", 2); F("Flags", 2);  S("Name"); B("Signature"); I("ParamList", Param); break; 
-		case MethodImpl: I("Class", TypeDef); I("MethodBody", MethodDefOrRef); I("MethodDeclaration", MethodDefOrRef); break; 
-		case MethodSemantics: F("Semantics", 2); I("Method", MethodDef); I("Association", HasSemantics); break; 
-		case MethodSpec: I("Method", MethodDefOrRef); B("Instantiation"); break; 
-		case Module: F("Generation", 2); S("Name"); G("Mvid"); G("EncId"); G("EncBaseId"); break; 
-		case ModuleRef: S("Name"); break; 
-		case NestedClass: I("NestedClass", TypeDef); I("EnclosingClass", TypeDef); break; 
-		case Param: F("Flags", 2); F("Sequence", 2); S("Name"); break; 
-		case Property: F("Flags", 2); S("Name"); B("Type"); break; 
-		case PropertyMap: I("Parent", TypeDef); I("PropertyList", Property); break; 
-		case StandAloneSig: B("Signature"); break; 
-		case TypeDef: F("Flags", 4); S("TypeName"); S("TypeNamespace"); I("Extends", TypeDefOrRef); I("FieldList",  Field); I("MethodList", MethodDef); break; 
-		case TypeRef: I("ResolutionScope", ResolutionScope); S("TypeName"); S("TypeNamespace"); break; 
-		case TypeSpec: B("Signature"); break; 
+#include "schema.def"
 		default: break; 
 	} 
 
@@ -249,82 +190,66 @@ static void table_for_each_field(int TYPE, void(*FUNC)(void * ctx, char type, co
 #undef S
 #undef G
 #undef B
-#undef I
+#undef T
+#undef C
 }
 
-static int get_field_size(struct Context * context, const int values[])
+static void init_index(struct Context * context, struct CodedIndex * index, const int tables[])
 {
+    memset(index, 0, sizeof(struct CodedIndex));
+    memset(index->tables, NotUsed, sizeof(index->tables));
+
     int count = 0;
     int maxRowCount = 0;
 
-	for(int i = 0; 1; i++) {
-        int type = values[i];
-        if(type < 0 || type >= 64) {
-            break;
-        }
-
-        struct Table * table = context->tables + type;
+    for(int i = 0; i < 32 && tables[i] >= 0 && tables[i] < 64; i++) {
+        struct Table * table = context->tables + tables[i];
         if (table->rowCount > maxRowCount) {
             maxRowCount = table->rowCount;
         }
-
-		count ++;
+        index->tables[i] = tables[i];
+        count ++;
     }
 
-	if (count > 1) {
-		int bit;
-		for(bit = 0; (1 << bit) < count; bit++);
-		maxRowCount <<= bit;
-	}
+    int bit = 0;
+    if (count > 1) {
+        for(bit = 0; (1 << bit) < count; bit++);
+    }
 
-	return (maxRowCount >= 65536) ? 4 : 2;
+    index->tagBits = bit;
+    index->tagMask = (1u << bit) - 1;
+    index->tableCount = count;
+    index->width = (((uint64_t)maxRowCount << bit) >= 65536) ? 4 : 2;
 }
 
-static int table_get_field_index(struct Table * table, int row, const char * field, int * tab) 
+// needs the row count of every table, so it runs after all of them are
+// read from the table stream header and before any column is sized
+static void init_indexes(struct Context * context)
 {
-	if (tab) *tab = 0;
-
-	int value = table_get_field_u64(table, row, field);
-	if (value == 0) {
-		return 0;
-	}
-
-	const int * values = (const int*)table_get_field_ctx(table, row, field);
-
-    int count = 0;
-	for(int i = 0; 1; i++) {
-        int type = values[i];
-        if(type < 0 || type >= 64) {
-            break;
-        }
-		count ++;
+    for (int i = 0; i < 64; i++) {
+        const int tables [] = {i, -1};
+        init_index(context, context->simpleIndex + i, tables);
     }
 
-	if (count <= 1) {
-		if (tab) *tab = values[0];
-		return value;
-	}
-
-	int bit = 0;
-	for(bit = 0; (1 << bit) < count; bit++);
-
-	if (tab) *tab = value & ((1 << bit) - 1);
-	return value >> bit;
+    for (int i = 0; i < CodedIndex_Count; i++) {
+        init_index(context, context->codedIndex + i, coded_lists[i]);
+    }
 }
 
-static const char * get_string(struct Context * context, struct Table * table, int row, const char * field, const char * def)
+// the descriptor for the element list table_for_each_field passes with an
+// index column, a coded_* list or a single table list
+static struct CodedIndex * find_index(struct Context * context, const int values[])
 {
-    uint64_t index = table_get_field_u64(table, row, field);
-
-    const char * value = def;
-    if (index >= 0 || index < context->stringHeap.size) {
-        value = context->stringHeap.ptr + index;
+    for (int i = 0; i < CodedIndex_Count; i++) {
+        if (coded_lists[i] == values) {
+            return context->codedIndex + i;
+        }
     }
 
-    return value;
+    assert(values[0] >= 0 && values[0] < 64 && values[1] < 0);
+    return context->simpleIndex + values[0];
 }
 
-
 #if 0
 static void dumpModule(struct Context * context)
 {
@@ -578,60 +503,44 @@ void _D(void * ctx, char type, const char * name, const int values [])
 
 struct PrintContext {
 	struct Context * context;
+	struct Output * out;
 	struct Table * table;
 	int row;
 };
 
-static void print_Hex(const char * ptr, size_t len, const char * sep) 
-{
-	for (size_t i = 0; i < len; i++) {
-        printf("%s%02X", (i != 0) ? sep : "", (unsigned char)ptr[i]);
-    }
-}
-
-static void print_GUID(struct Context * context, int value)
+static void print_GUID(struct Context * context, struct Output * out, const char * name, int value)
 {
 	const char * ptr = context->guidHeap.ptr + value * 16;
-	print_Hex(ptr, 16, "-");
+	output_field_bytes(out, name, ptr, 16, '-');
 }
 
-static void print_Blob(struct Context * context, int value)
+static void print_Blob(struct Context * context, struct Output * out, const char * name, int value)
 {
-	printf("%d", value);
-	/*
-	const char * ptr = context->blobHeap.ptr + value;
 	uint32_t len;
-	ptr = readBlob(ptr, &len);
+	const char * ptr = clr_get_blob(context, value, &len);
 
-	print_Hex(ptr, len, " ");
-	*/
+	output_text(out, "blob:");
+	output_text_u64(out, value);
+	output_text(out, " ");
+	output_field_bytes(out, name, ptr, len, ' ');
 }
 
-static void print_Index(struct Context * context, const int types[], int value)
+static void print_Index(struct Context * context, struct Output * out, const char * name, const int types[], int value)
 {
-	int count = 0;
-    int maxRowCount = 0;
-
-	for(int i = 0; 1; i++) {
-        int type = types[i];
-        if(type < 0 || type >= 64) {
-            break;
-        }
-		count ++;
-    }
+	int type;
+	value = decode_coded_index(find_index(context, types), value, &type);
 
-	int type = types[0];
-	if (count > 1) {
-		int bit;
-		for(bit = 0; (1 << bit) < count; bit++);
-		type = types[value & ((1<<bit)-1)];
-		value = value >> bit;
-	}
-	
+	// a metadata token in JSON
 	if (value == 0) {
-		printf("<nil>");
+		output_text(out, "<nil>");
+		output_meta_u64(out, name, 0);
 	} else {
-		printf("<table:%d, index:%d>", type, value);
+		output_text(out, "<table:");
+		output_text_u64(out, type);
+		output_text(out, ", index:");
+		output_text_u64(out, value);
+		output_text(out, ">");
+		output_meta_u64(out, name, ((uint64_t)type << 24) | value);
 	}
 }
 
@@ -640,42 +549,65 @@ static void print_field(void * ctx, char type, const char * name, const int valu
 	struct PrintContext * pc = (struct PrintContext*)ctx;
 
 	struct Context * context = pc->context;
+	struct Output * out = pc->out;
 	struct Table * table = pc->table;
 	int row = pc->row;
 
 	uint64_t value = table_get_field_u64(table, row, name);
 
+	// "  %-10s value"
+	output_text(out, "\n  ");
+	output_text(out, name);
+	for (size_t n = strlen(name); n < 10; n++) {
+		output_text(out, " ");
+	}
+	output_text(out, " ");
+
 	switch(type) {
 	case 'F':
-		printf("  %-10s %lu\n", name, value);
+		output_field_u64(out, name, value);
 		break;
 	case 'S':
 		assert(value >= 0 || value < context->stringHeap.size);
-		printf("  %-10s %s\n", name, context->stringHeap.ptr + value);
+		output_field_str(out, name, context->stringHeap.ptr + value);
 		break;
 	case 'G':
-		printf("  %-10s guid:", name); print_GUID(context, value); printf("\n"); 
+		output_text(out, "guid:"); print_GUID(context, out, name, value);
 		break;
 	case 'B':
-		printf("  %-10s blob:", name); print_Blob(context, value); printf("\n");
+		print_Blob(context, out, name, value);
 		break;
 	case 'I':
-		printf("  %-10s ", name); print_Index(context, values, value); printf("\n");
+		print_Index(context, out, name, values, value);
 		break;
 	}
 }
 
 static void print_table(struct Context * context, int type) 
 {
-	printf("-- <table:%d> --\n", type);
+	struct Output out;
+	output_init(&out, context->out, context->format);
+
+	output_begin(&out, "table");
+	output_text(&out, "-- <table:");
+	output_field_u64(&out, "table", type);
+	output_text(&out, "> --");
+	output_end(&out);
+
 	struct Table * table = context->tables + type;
-	struct PrintContext pc = {context, table, 0};
+	struct PrintContext pc = {context, &out, table, 0};
 	for (int i = 0; i < table->rowCount; i++) {
 		pc.row = i;
-		printf("%d:\n", i+1);
+		output_begin(&out, "row");
+		output_meta_u64(&out, "table", type);
+		output_field_u64(&out, "row", i+1);
+		output_text(&out, ":");
 		table_for_each_field(type, print_field, &pc); 
+		output_end(&out);
 	}
-	printf("\n");
+	output_text(&out, "\n");
+
+	output_free(&out);
 }
 
 void _F(void * ctx, char type, const char * name, const int values [])
@@ -696,7 +628,7 @@ void _F(void * ctx, char type, const char * name, const int values [])
 		case 'S': field->size = (HeapSizes & 0x01) ? 4 : 2; break;
 		case 'G': field->size = (HeapSizes & 0x02) ? 4 : 2; break;
 		case 'B': field->size = (HeapSizes & 0x04) ? 4 : 2; break;
-		case 'I': field->size = get_field_size(context, values); field->ctx = (void*)values; break;
+		case 'I': field->ctx = find_index(context, values); field->size = ((struct CodedIndex*)field->ctx)->width; break;
 		default: assert(0);
 	}
 
@@ -716,7 +648,7 @@ static struct FieldInfo * get_table_fields(struct Context * context, int i)
 	struct FieldInfo * ite = xc.field;
     if (ite == ret) {
         fprintf(stderr, "unknown table type 0x%02x\n", i);
-        exit(-1);
+        return 0;
     }
 	ite->type = 0; ite->size = 0; ite->name = 0; ite++; 
 
@@ -726,17 +658,24 @@ static struct FieldInfo * get_table_fields(struct Context * context, int i)
 }
 
 
-static void parseMetatable(const char * ptr, size_t size, struct Context * context)
+// the reserved fields are not checked: Reserved2 is documented as always
+// 1, but the framework's own assemblies carry other values and the
+// runtime ignores it
+static int parseMetatable(const char * ptr, size_t size, struct Context * context)
 {
-	READ_TABLE(MetadataTableHeader, 1);
+	const char * end = ptr + size;
+	if (size < sizeof(struct TMetadataTableHeader)) {
+		return -1;
+	}
 
-    assert(MetadataTableHeader->Reserved1 == 0);
-    assert(MetadataTableHeader->Reserved2 == 1);
+	READ_TABLE(MetadataTableHeader, 1);
 
     uint64_t Valid = MetadataTableHeader->Valid;
     uint64_t Sorted = MetadataTableHeader->Sorted;
 
     context->HeapSizes = MetadataTableHeader->HeapSizes;
+    context->Valid = Valid;
+    context->Sorted = Sorted;
 
     int tableCount = 0;
 
@@ -750,8 +689,19 @@ static void parseMetatable(const char * ptr, size_t size, struct Context * conte
 
     // printf("Valid count %d, HeapSizes %d\n", tableCount, context->HeapSizes);
 
+    if ((size_t)(end - ptr) < 4 * (size_t)tableCount) {
+        return -1;
+    }
     ptr += 4 * tableCount;
 
+    for (int i = 0, n = 0; i < 64; i++) {
+        if (is_bit_set(Valid, i)) {
+            context->tables[i].rowCount = rows[n++];
+        }
+    }
+
+    init_indexes(context);
+
     for (int i = 0; i < 64; i++) {
         if (is_bit_set(Valid, i)) {
             int row = *(rows++);
@@ -759,117 +709,503 @@ static void parseMetatable(const char * ptr, size_t size, struct Context * conte
             struct FieldInfo * fields = get_table_fields(context, i);
             // printf("table 0x%x, rows %u %p %p %s\n", i, row, ptr, fields, fields[0].name);
 
-            assert(fields);
+            if (fields == 0) {
+                return -1;
+            }
             ptr = table_init(context->tables + i, fields, ptr, row);
+            if (ptr > end) {
+                return -1;
+            }
 			// print_table(context, i);
         }
     }
+
+    return 0;
 }
 
-void clr_dump_type(struct Context * context) {
-	struct Table * MethodDefTable = context->tables + MethodDef;
-	int maxMethodCount = MethodDefTable->rowCount;
-
-	struct Table * TypeDefTable = context->tables + TypeDef;
-	for (int i = 0; i < TypeDefTable->rowCount; i++) {
-		uint64_t flag = table_get_field_u64(TypeDefTable, i, "Flags");
-		const char * TypeName = get_string(context, TypeDefTable, i, "TypeName", "-");
-		const char * TypeNamespace = get_string(context, TypeDefTable, i, "TypeNamespace", "");
-		// Extends
-		// case TypeDef: F("Flags", 4); S("TypeName"); S("TypeNamespace"); I("Extends", TypeDefOrRef); I("FieldList",  Field); I("MethodList", MethodDef); break; 
-
-		int MethodList = table_get_field_index(TypeDefTable, i, "MethodList", 0);
-		// uint64_t MethodList = table_get_field_u64(TypeDefTable, i, "MethodList");
-
-		printf("%s.%s  %d\n", TypeNamespace, TypeName, MethodList);
-
-		int from = (int)MethodList;
-		int to = maxMethodCount;
-		if (i < TypeDefTable->rowCount - 1) {
-			to = table_get_field_index(TypeDefTable, i + 1, "MethodList", 0);
+void close_clr(struct Context * context)
+{
+	lookup_free(context);
+	owner_free(context);
+	symbol_free(context);
+	signature_free(context);
+	userstring_free(context);
+	attribute_free(context);
+	verify_free(context);
+}
+
+const char * clr_get_blob(struct Context * context, uint32_t index, uint32_t * len)
+{
+	*len = 0;
+
+	if (index >= context->blobHeap.size) {
+		return 0;
+	}
+
+	const char * end = context->blobHeap.ptr + context->blobHeap.size;
+	const char * ptr = read_compressed(context->blobHeap.ptr + index, end, len);
+	if (ptr == 0 || *len > (uint32_t)(end - ptr)) {
+		*len = 0;
+		return 0;
+	}
+
+	return ptr;
+}
+
+static void set_slice(struct Slice * slice, const char * metadata, uint32_t offset, uint32_t size)
+{
+	slice->ptr = size > 0 ? metadata + offset : 0;
+	slice->size = size;
+}
+
+static uint32_t slice_offset(const struct Slice * slice, const char * metadata)
+{
+	return slice->ptr ? (uint32_t)(slice->ptr - metadata) : 0;
+}
+
+void clr_get_layout(struct Context * context, struct ClrLayout * layout)
+{
+	memset(layout, 0, sizeof(struct ClrLayout));
+
+	layout->MetaDataVirtualAddress = context->MetaDataVirtualAddress;
+	layout->MetaDataSize = context->MetaDataSize;
+
+	const struct Slice * heaps[5] = { &context->stringHeap, &context->guidHeap, &context->blobHeap, &context->unicodeHeap, &context->tableStream };
+	for (int i = 0; i < 5; i++) {
+		layout->heapOffset[i] = slice_offset(heaps[i], context->metadata);
+		layout->heapSize[i] = heaps[i]->size;
+	}
+
+	layout->HeapSizes = context->HeapSizes;
+	layout->Valid = context->Valid;
+	layout->Sorted = context->Sorted;
+
+	for (int i = 0; i < 64; i++) {
+		layout->rowCount[i] = context->tables[i].rowCount;
+	}
+
+	layout->fieldCount = context->filedUsed;
+	for (int i = 0; i < context->filedUsed; i++) {
+		layout->fieldSize[i] = context->fields[i].size;
+	}
+}
+
+struct LayoutContext {
+	struct Context * context;
+	struct FieldInfo * field;
+	const uint8_t * size;
+	const uint8_t * end;
+};
+
+static void _L(void * ctx, char type, const char * name, const int values [])
+{
+	struct LayoutContext * lc = (struct LayoutContext*)ctx;
+	struct FieldInfo * field = lc->field;
+
+	field->type = type;
+	field->name = name;
+	field->size = (lc->size < lc->end) ? *lc->size : 0;
+	field->ctx = (type == 'I') ? find_index(lc->context, values) : 0;
+
+	lc->field++;
+	lc->size++;
+}
+
+// same as read_clr, but stream locations, row counts and column widths come
+// from a layout saved by clr_get_layout instead of being computed. the
+// layout is checked against the table stream header before it is used.
+int read_clr_layout(struct Context * context, struct PEFile * file, const struct ClrLayout * layout)
+{
+	if (layout->fieldCount > sizeof(layout->fieldSize) || layout->fieldCount > sizeof(context->fields) / sizeof(context->fields[0])) {
+		return -1;
+	}
+
+	const char * metadata = find_virtual_range(file, layout->MetaDataVirtualAddress, layout->MetaDataSize);
+	if (metadata == 0) {
+		return -1;
+	}
+
+	for (int i = 0; i < 5; i++) {
+		if ((uint64_t)layout->heapOffset[i] + layout->heapSize[i] > layout->MetaDataSize) {
+			return -1;
 		}
+	}
+
+	const char * tables = metadata + layout->heapOffset[4];
+	size_t tablesSize = layout->heapSize[4];
 
-		for (int j = from; j < to; j ++) {
-			clr_dump_method(context, j);
+	int tableCount = 0;
+	for (int i = 0; i < 64; i++) {
+		if (is_bit_set(layout->Valid, i)) {
+			tableCount ++;
 		}
 	}
 
-	struct Table * TypeRefTable = context->tables + TypeRef;
-	for (int i = 0; i < TypeRefTable->rowCount; i++) {
-		const char * TypeName = get_string(context, TypeRefTable, i, "TypeName", "-");
-		const char * TypeNamespace = get_string(context, TypeRefTable, i, "TypeNamespace", "");
-		printf("@%s.%s\n", TypeNamespace, TypeName);
+	if (tablesSize < sizeof(struct TMetadataTableHeader) + 4 * tableCount) {
+		return -1;
+	}
+
+	const struct TMetadataTableHeader * header = (const struct TMetadataTableHeader*)tables;
+	if (header->Valid != layout->Valid || header->HeapSizes != layout->HeapSizes) {
+		return -1;
 	}
+
+	const uint32_t * rows = (const uint32_t*)(header + 1);
+	for (int i = 0, n = 0; i < 64; i++) {
+		if (is_bit_set(layout->Valid, i) && rows[n++] != layout->rowCount[i]) {
+			return -1;
+		}
+	}
+
+	memset(context, 0, sizeof(struct Context));
+	context->file = file;
+	context->out = stdout;
+	context->metadata = metadata;
+	context->MetaDataVirtualAddress = layout->MetaDataVirtualAddress;
+	context->MetaDataSize = layout->MetaDataSize;
+
+	struct Slice * heaps[5] = { &context->stringHeap, &context->guidHeap, &context->blobHeap, &context->unicodeHeap, &context->tableStream };
+	for (int i = 0; i < 5; i++) {
+		set_slice(heaps[i], metadata, layout->heapOffset[i], layout->heapSize[i]);
+	}
+
+	context->HeapSizes = layout->HeapSizes;
+	context->Valid = layout->Valid;
+	context->Sorted = layout->Sorted;
+
+	for (int i = 0; i < 64; i++) {
+		context->tables[i].rowCount = is_bit_set(layout->Valid, i) ? layout->rowCount[i] : 0;
+	}
+
+	init_indexes(context);
+
+	const char * ptr = (const char*)(rows + tableCount);
+	const uint8_t * size = layout->fieldSize;
+	const uint8_t * end = layout->fieldSize + layout->fieldCount;
+
+	for (int i = 0; i < 64; i++) {
+		if (!is_bit_set(layout->Valid, i)) {
+			continue;
+		}
+
+		struct FieldInfo * fields = context->fields + context->filedUsed;
+		struct LayoutContext lc = { context, fields, size, end };
+		table_for_each_field(i, _L, &lc);
+
+		if (lc.field == fields || lc.size >= end || *lc.size != 0) {
+			return -1;
+		}
+
+		struct FieldInfo * ite = lc.field;
+		ite->type = 0; ite->size = 0; ite->name = 0; ite->ctx = 0; ite++;
+		context->filedUsed += ite - fields;
+		size = lc.size + 1;
+
+		ptr = table_init(context->tables + i, fields, ptr, layout->rowCount[i]);
+		if (ptr > tables + tablesSize) {
+			return -1;
+		}
+	}
+
+	return 0;
 }
 
-void clr_dump_method(struct Context * context, int methodIndex) {
-	methodIndex = methodIndex - 1;
+static const char * heap_string(struct Context * context, uint32_t index, const char * def)
+{
+	return (index < context->stringHeap.size) ? context->stringHeap.ptr + index : def;
+}
+
+static void dump_method(struct Context * context, struct Output * out, int row);
+
+// the methods dumped under TypeDef i, [from, to)
+static void type_method_range(struct Table * tables, int i, int * from, int * to) {
+	int typeCount = tables[TypeDef].rowCount;
+
+	*from = Row<TypeDef>(tables, i).MethodList();
+	*to = tables[MethodDef].rowCount;
+	if (i < typeCount - 1) {
+		*to = Row<TypeDef>(tables, i + 1).MethodList();
+	}
+}
+
+// the lines of TypeDef i are its header, part 0, then one part per method
+static int type_part_count(struct Table * tables, int i) {
+	int from, to;
+	type_method_range(tables, i, &from, &to);
+	return 1 + (to > from ? to - from : 0);
+}
 
-	struct Table * MethodDefTabe = context->tables + MethodDef;
+static void dump_type_parts(struct Context * context, struct Output * out, int i, int first, int last) {
+	struct Table * tables = context->tables;
+	int from, to;
+	type_method_range(tables, i, &from, &to);
+
+	if (first == 0) {
+		Row<TypeDef> type(tables, i);
+		output_begin(out, "type");
+		output_field_str(out, "namespace", heap_string(context, type.TypeNamespace(), ""));
+		output_text(out, ".");
+		output_field_str(out, "name", heap_string(context, type.TypeName(), "-"));
+		output_text(out, "  ");
+		output_field_i64(out, "methodList", from);
+		output_end(out);
+		first = 1;
+	}
 
-	const char * ptr = find_virtual_addr(context->file, table_get_field_u64(MethodDefTabe, methodIndex, "RVA"));
-	printf("%s %02X\n", get_string(context, MethodDefTabe, methodIndex, "Name", "-"), ptr[0]);
+	for (int j = from + first - 1; j < from + last - 1; j ++) {
+		dump_method(context, out, j - 1);
+	}
+}
 
-	if ((ptr[0] & 0x3) == 0x2) {
-		int len = ((unsigned char)ptr[0]) >> 2;
-		ptr ++;
-		const char * end = ptr + len;
-		while(ptr < end) {
-			ptr = dump_opcode(ptr);
+static void dump_type_refs(struct Context * context, struct Output * out) {
+	struct Table * tables = context->tables;
+	for (size_t i = 0; i < tables[TypeRef].rowCount; i++) {
+		Row<TypeRef> type(tables, i);
+		output_begin(out, "typeref");
+		output_text(out, "@");
+		output_field_str(out, "namespace", heap_string(context, type.TypeNamespace(), ""));
+		output_text(out, ".");
+		output_field_str(out, "name", heap_string(context, type.TypeName(), "-"));
+		output_end(out);
+	}
+}
+
+void clr_dump_type(struct Context * context) {
+	struct Table * tables = context->tables;
+	int typeCount = tables[TypeDef].rowCount;
+
+	struct Output out;
+	output_init(&out, context->out, context->format);
+
+	for (int i = 0; i < typeCount; i++) {
+		dump_type_parts(context, &out, i, 0, type_part_count(tables, i));
+	}
+
+	dump_type_refs(context, &out);
+
+	output_free(&out);
+}
+
+// parallel dump: the parts of all types, in the serial order, are cut
+// into chunks that the pool formats into memory outputs. buffers are
+// written out in chunk order by whichever worker completes the next one
+// in line, so the output is that of clr_dump_type.
+
+#define DUMP_CHUNKS_PER_THREAD 8
+#define DUMP_MIN_CHUNK 64
+
+struct DumpBuffer {
+	char * buf;
+	size_t len;
+	int done;
+};
+
+struct DumpJob {
+	struct Context * context;
+	const int * partStart; // typeCount + 1, first part of each type
+	int typeCount;
+	int chunkSize;
+	int chunkCount;
+
+	struct DumpBuffer * buffers;
+
+	pthread_mutex_t lock;
+	int next;
+};
+
+static void dump_chunk(struct DumpJob * job, struct Output * out, int index) {
+	int begin = index * job->chunkSize;
+	int end = begin + job->chunkSize;
+	if (end > job->partStart[job->typeCount]) {
+		end = job->partStart[job->typeCount];
+	}
+
+	// the type holding part begin
+	int lo = 0, hi = job->typeCount;
+	while (hi - lo > 1) {
+		int mid = (lo + hi) / 2;
+		if (job->partStart[mid] <= begin) {
+			lo = mid;
+		} else {
+			hi = mid;
 		}
-		return;
 	}
 
-	// fat header
-	struct buffer buffer;
-	buffer_init(&buffer, ptr, 1000);
-	uint16_t flag = buffer_read_u16(&buffer);
-	uint16_t size = flag >> 12;
-	flag = flag & 0x0FFF;
+	for (int i = lo; i < job->typeCount && job->partStart[i] < end; i++) {
+		int first = (begin > job->partStart[i]) ? begin - job->partStart[i] : 0;
+		int last = ((end < job->partStart[i + 1]) ? end : job->partStart[i + 1]) - job->partStart[i];
+		dump_type_parts(job->context, out, i, first, last);
+	}
+}
+
+static void dump_chunk_work(void * ctx, int index, int) {
+	struct DumpJob * job = (struct DumpJob*)ctx;
+	struct DumpBuffer * buffer = job->buffers + index;
+
+	struct Output out;
+	output_init(&out, 0, job->context->format);
+	dump_chunk(job, &out, index);
+	buffer->buf = output_take(&out, &buffer->len);
+	output_free(&out);
+
+	pthread_mutex_lock(&job->lock);
+	buffer->done = 1;
+	while (job->next < job->chunkCount && job->buffers[job->next].done) {
+		struct DumpBuffer * b = job->buffers + job->next;
+		if (b->buf == 0) {
+			// out of memory, format this chunk again straight into the output
+			output_init(&out, job->context->out, job->context->format);
+			dump_chunk(job, &out, job->next);
+			output_free(&out);
+		} else {
+			fwrite(b->buf, 1, b->len, job->context->out);
+		}
+		free(b->buf);
+		b->buf = 0;
+		job->next++;
+	}
+	pthread_mutex_unlock(&job->lock);
+}
+
+void clr_dump_type_parallel(struct Context * context, int threads) {
+	struct Table * tables = context->tables;
+	int typeCount = tables[TypeDef].rowCount;
 
-	uint16_t MaxStack = buffer_read_u16(&buffer); // MaxStack Maximum number of items on the operand stack
-	uint32_t CodeSize = buffer_read_u32(&buffer); // Size in bytes of the actual method body
-	uint32_t LocalVarSigTok = buffer_read_u32(&buffer); // Meta Data token for a signature describing the layout of the local variables for the method.
+	int * partStart = (threads > 1) ? (int*)malloc(sizeof(int) * (typeCount + 1)) : 0;
+	if (partStart == 0) {
+		clr_dump_type(context);
+		return;
+	}
+
+	partStart[0] = 0;
+	for (int i = 0; i < typeCount; i++) {
+		partStart[i + 1] = partStart[i] + type_part_count(tables, i);
+	}
+	int parts = partStart[typeCount];
+
+	// a few chunks per thread so stealing can even out slow ones
+	struct DumpJob job;
+	job.context = context;
+	job.partStart = partStart;
+	job.typeCount = typeCount;
+	job.chunkSize = parts / (threads * DUMP_CHUNKS_PER_THREAD) + 1;
+	if (job.chunkSize < DUMP_MIN_CHUNK) {
+		job.chunkSize = DUMP_MIN_CHUNK;
+	}
+	job.chunkCount = (parts + job.chunkSize - 1) / job.chunkSize;
+	job.buffers = (struct DumpBuffer*)calloc(job.chunkCount > 0 ? job.chunkCount : 1, sizeof(struct DumpBuffer));
+	job.next = 0;
+	pthread_mutex_init(&job.lock, 0);
 
-	printf("# MaxStack %u, CodeSize = %d, LocalVarSigTok = %x, flag = %x, size = %d\n", MaxStack, CodeSize, LocalVarSigTok, flag, size);
-	ptr = buffer.ptr + buffer.pos;
+	if (job.buffers == 0) {
+		clr_dump_type(context);
+	} else {
+		pool_run(threads, job.chunkCount, dump_chunk_work, &job);
 
-	// body
-	const char * end = ptr + CodeSize;
-	while(ptr < end) {
-		ptr = dump_opcode(ptr);
+		struct Output out;
+		output_init(&out, context->out, context->format);
+		dump_type_refs(context, &out);
+		output_free(&out);
 	}
 
-	/*
-	ptr = end + (4 - ((unsigned long)end) % 4);
+	pthread_mutex_destroy(&job.lock);
+	free(job.buffers);
+	free(partStart);
+}
+
+void clr_dump_method(struct Context * context, int methodIndex) {
+	struct Output out;
+	output_init(&out, context->out, context->format);
+	dump_method(context, &out, methodIndex - 1);
+	output_free(&out);
+}
 
-	dumpHex(ptr, 8, " ");
+static void dump_code(struct Context * context, struct Output * out, const char * code, uint32_t size) {
+	struct ILReader reader;
+	il_reader_init(&reader, code, size);
 
-	buffer_init(&buffer, ptr, 1000);
+	struct ILInstruction insn;
+	int ret;
+	while ((ret = il_next(&reader, &insn)) > 0) {
+		il_print(context, out, &insn);
+	}
+	if (ret < 0) {
+		output_begin(out, "error");
+		output_text(out, "# bad instruction at ");
+		output_field_hex(out, "offset", reader.offset, 0, OUTPUT_UPPER);
+		output_end(out);
+	}
+}
 
-	uint8_t kind = buffer_read_u8(&buffer);
-	if (kind & 0x1) {
-		printf("CorILMethod_Sect_EHTable 0x1 Exception handling data.\n");
+static void dump_clause(struct Output * out, const struct ILExceptionClause * clause) {
+	output_begin(out, "clause");
+	output_text(out, "# .try ");
+	output_field_hex(out, "tryStart", clause->tryOffset, 0, OUTPUT_UPPER);
+	output_text(out, " to ");
+	output_field_hex(out, "tryEnd", clause->tryOffset + clause->tryLength, 0, OUTPUT_UPPER);
+	output_text(out, " ");
+	if (clause->flags & IL_CLAUSE_FILTER) {
+		output_field_str(out, "kind", "filter");
+		output_text(out, " ");
+		output_field_hex(out, "filter", clause->filterOffset, 0, OUTPUT_UPPER);
+	} else if (clause->flags & IL_CLAUSE_FINALLY) {
+		output_field_str(out, "kind", "finally");
+	} else if (clause->flags & IL_CLAUSE_FAULT) {
+		output_field_str(out, "kind", "fault");
+	} else {
+		output_field_str(out, "kind", "catch");
+		output_text(out, " ");
+		output_field_hex(out, "classToken", clause->classToken, 0, OUTPUT_UPPER);
 	}
+	output_text(out, " handler ");
+	output_field_hex(out, "handlerStart", clause->handlerOffset, 0, OUTPUT_UPPER);
+	output_text(out, " to ");
+	output_field_hex(out, "handlerEnd", clause->handlerOffset + clause->handlerLength, 0, OUTPUT_UPPER);
+	output_end(out);
+}
 
-	if (kind & 0x2) {
-		printf("CorILMethod_Sect_OptILTable 0x2 Reserved, shall be 0.\n");
+// MethodDef row, 0 based
+static void dump_method(struct Context * context, struct Output * out, int row) {
+	Row<MethodDef> method(context->tables, row);
+	uint64_t RVA = method.RVA();
+	const char * ptr = RVA ? find_virtual_range(context->file, RVA, 1) : 0;
+
+	output_begin(out, "method");
+	output_meta_u64(out, "token", 0x06000000 | (row + 1));
+	output_field_str(out, "name", heap_string(context, method.Name(), "-"));
+	if (ptr == 0) {
+		// abstract, extern and runtime methods have no body
+		output_end(out);
+		return;
 	}
+	output_text(out, " ");
+	output_field_hex(out, "header", (unsigned char)ptr[0], 2, OUTPUT_UPPER);
+	output_end(out);
 
-	if (kind & 0x40) {
-		printf("CorILMethod_Sect_FatFormat 0x40 Data format is of the fat variety\n");
+	struct ILMethodBody body;
+	if (il_method_body(context->file, RVA, &body) != 0) {
+		return;
 	}
 
-	if (kind & 0x80) {
-		printf("CorILMethod_Sect_MoreSects 0x80 Another data section occurs after this current section\n");
+	if ((body.flags & 0x3) == IL_METHOD_FAT) {
+		output_begin(out, "fat");
+		output_text(out, "# MaxStack ");
+		output_field_u64(out, "maxStack", body.maxStack);
+		output_text(out, ", CodeSize = ");
+		output_field_i64(out, "codeSize", (int32_t)body.codeSize);
+		output_text(out, ", LocalVarSigTok = ");
+		output_field_hex(out, "localVarSigTok", body.localVarSigTok, 0, OUTPUT_LOWER);
+		output_text(out, ", flag = ");
+		output_field_hex(out, "flags", body.flags, 0, OUTPUT_LOWER);
+		output_text(out, ", size = ");
+		output_field_i64(out, "headerSize", body.headerSize / 4);
+		output_end(out);
 	}
-	*/
-	
-	// buffer_init(&buffer, end, 1000);
-	// flag = buffer_read_u8(&buffer);
-	// printf("Flag %x\n", flag);
 
+	dump_code(context, out, body.code, body.codeSize);
 
-	// dumpHex(ptr, 16, " ");
-	// assert(0);
+	struct ILExceptionClause clause;
+	for (uint32_t i = 0; il_method_clause(&body, i, &clause) == 0; i++) {
+		dump_clause(out, &clause);
+	}
 }
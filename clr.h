@@ -1,32 +1,133 @@
 #ifndef _CLRPARSER_CLR_H_
 #define _CLRPARSER_CLR_H_
 
+#include <stdio.h>
+#include <string.h>
+
 #include "pe.h"
 #include "table.h"
+#include "schema.h"
 
 struct Slice {
     const char * ptr;
     size_t size;
 };
 
+struct LookupCache;
+struct OwnerIndex;
+struct SymbolIndex;
+struct SignatureCache;
+struct UserStringCache;
+struct AttributeCache;
+struct StackCache;
+
 struct Context {
     struct PEFile * file;
+    FILE * out; // dumpers write here, stdout unless changed after read_clr
+    int format; // OUTPUT_TEXT or OUTPUT_JSON, text unless changed after read_clr
+
+    const char * metadata; // metadata root
+    uint32_t MetaDataVirtualAddress;
+    uint32_t MetaDataSize;
 
     struct Slice stringHeap;
     struct Slice guidHeap;
     struct Slice blobHeap;
     struct Slice unicodeHeap;
+    struct Slice tableStream;
 
     int HeapSizes;
+    uint64_t Valid;
+    uint64_t Sorted;
 
     struct Table tables[64];
 
+    // decoding of index columns, FieldInfo.ctx of an index column points
+    // at one of these
+    struct CodedIndex codedIndex[CodedIndex_Count];
+    struct CodedIndex simpleIndex[64];
+
     struct FieldInfo fields[200]; // 160
     int filedUsed;
+
+    // built on first use, released by close_clr
+    struct LookupCache * lookups;
+    struct OwnerIndex * owners;
+    struct SymbolIndex * symbols;
+    struct SignatureCache * signatures;
+    struct UserStringCache * userStrings;
+    struct AttributeCache * attributes;
+    struct StackCache * stacks;
+};
+
+// everything read_clr derives from the metadata root, as plain data.
+// offsets are relative to the metadata root.
+struct ClrLayout {
+    uint32_t MetaDataVirtualAddress;
+    uint32_t MetaDataSize;
+
+    uint32_t heapOffset[5]; // #Strings, #GUID, #Blob, #US, #~
+    uint32_t heapSize[5];
+
+    uint32_t HeapSizes;
+    uint64_t Valid;
+    uint64_t Sorted;
+
+    uint32_t rowCount[64];
+
+    uint32_t fieldCount;
+    uint8_t fieldSize[200]; // column widths of the present tables, 0 ends a table
 };
 
 int read_clr(struct Context * context, struct PEFile * file);
+int read_clr_layout(struct Context * context, struct PEFile * file, const struct ClrLayout * layout);
+void close_clr(struct Context * context);
+
+// ECMA-335 II.23.2 compressed unsigned integer at ptr, returns the byte
+// after it or 0 if it runs past end. the top three bits of the first byte
+// select length, shift and mask, so away from the end of the heap the
+// value is one big endian load and no branch on its form.
+static inline const char * read_compressed(const char * ptr, const char * end, uint32_t * value)
+{
+    static const struct { uint8_t len, shift; uint32_t mask; } forms[8] = {
+        { 1, 24, 0x7F }, { 1, 24, 0x7F }, { 1, 24, 0x7F }, { 1, 24, 0x7F },
+        { 2, 16, 0x3FFF }, { 2, 16, 0x3FFF }, { 4, 0, 0x1FFFFFFF }, { 0, 0, 0 },
+    };
+
+    if (ptr >= end) {
+        return 0;
+    }
+
+    const unsigned char * p = (const unsigned char *)ptr;
+    int form = p[0] >> 5;
+    size_t len = forms[form].len;
+
+    uint32_t raw;
+    if (end - ptr >= 4) {
+        memcpy(&raw, p, 4);
+        raw = __builtin_bswap32(raw);
+    } else {
+        if (len == 0 || (size_t)(end - ptr) < len) {
+            return 0;
+        }
+        raw = 0;
+        for (size_t i = 0; i < len; i++) {
+            raw |= (uint32_t)p[i] << (24 - 8 * i);
+        }
+    }
+
+    *value = (raw >> forms[form].shift) & forms[form].mask;
+    return len ? ptr + len : 0;
+}
+
+// the blob at index of the #Blob heap without its length prefix, 0 if it
+// does not fit the heap
+const char * clr_get_blob(struct Context * context, uint32_t index, uint32_t * len);
+void clr_get_layout(struct Context * context, struct ClrLayout * layout);
 void clr_dump_type(struct Context * context);
+
+// the same output, the methods formatted on threads
+void clr_dump_type_parallel(struct Context * context, int threads);
 void clr_dump_method(struct Context * context, int methodIndex);
 
 #endif
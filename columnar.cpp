@@ -0,0 +1,139 @@
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "columnar.h"
+#include "schema.h"
+
+// one loop per width, so the load in the loop body has a fixed size. cells
+// are not aligned, memcpy is what keeps the loads legal.
+template<int WIDTH> static inline uint32_t load_cell(const char * ptr)
+{
+    if (WIDTH == 4) {
+        uint32_t v; memcpy(&v, ptr, 4); return v;
+    } else if (WIDTH == 2) {
+        uint16_t v; memcpy(&v, ptr, 2); return v;
+    } else {
+        return *(const uint8_t*)ptr;
+    }
+}
+
+template<int WIDTH> static void decode_strided(const char * ptr, size_t stride, size_t count, uint32_t * out)
+{
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4, ptr += stride * 4) {
+        out[i + 0] = load_cell<WIDTH>(ptr);
+        out[i + 1] = load_cell<WIDTH>(ptr + stride);
+        out[i + 2] = load_cell<WIDTH>(ptr + stride * 2);
+        out[i + 3] = load_cell<WIDTH>(ptr + stride * 3);
+    }
+
+    for (; i < count; i++, ptr += stride) {
+        out[i] = load_cell<WIDTH>(ptr);
+    }
+}
+
+// single column tables (TypeSpec, StandAloneSig, ModuleRef) store the
+// column back to back, 2 byte cells are widened 8 at a time
+static void decode_packed_u16(const char * ptr, size_t count, uint32_t * out)
+{
+    size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(ptr + i * 2));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_unpacklo_epi16(v, zero));
+        _mm_storeu_si128((__m128i*)(out + i + 4), _mm_unpackhi_epi16(v, zero));
+    }
+#endif
+
+    for (; i < count; i++) {
+        out[i] = load_cell<2>(ptr + i * 2);
+    }
+}
+
+size_t table_decode_column(const struct Table * table, int column, size_t first, size_t count, uint32_t * out)
+{
+    if (table->ptr == 0 || column < 0 || column >= TABLE_MAX_COLUMNS || first >= table->rowCount) {
+        return 0;
+    }
+
+    if (count > table->rowCount - first) {
+        count = table->rowCount - first;
+    }
+
+    size_t stride = table->cellSize;
+    int width = table->width[column];
+    const char * ptr = table->ptr + stride * first + table->offset[column];
+
+    if (width == (int)stride) {
+        switch(width) {
+            case 4: memcpy(out, ptr, count * 4); return count;
+            case 2: decode_packed_u16(ptr, count, out); return count;
+        }
+    }
+
+    switch(width) {
+        case 4: decode_strided<4>(ptr, stride, count, out); break;
+        case 2: decode_strided<2>(ptr, stride, count, out); break;
+        case 1: decode_strided<1>(ptr, stride, count, out); break;
+        default: assert(0); return 0;
+    }
+
+    return count;
+}
+
+void table_split_coded(const uint32_t * values, size_t count, int tagBits, uint8_t * tags, uint32_t * rows)
+{
+    uint32_t mask = (1u << tagBits) - 1;
+
+    size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128i vmask = _mm_set1_epi32(mask);
+    const __m128i shift = _mm_cvtsi32_si128(tagBits);
+    for (; i + 16 <= count; i += 16) {
+        __m128i v0 = _mm_loadu_si128((const __m128i*)(values + i));
+        __m128i v1 = _mm_loadu_si128((const __m128i*)(values + i + 4));
+        __m128i v2 = _mm_loadu_si128((const __m128i*)(values + i + 8));
+        __m128i v3 = _mm_loadu_si128((const __m128i*)(values + i + 12));
+
+        // tags are below 32, the signed saturating packs leave them alone
+        __m128i t01 = _mm_packs_epi32(_mm_and_si128(v0, vmask), _mm_and_si128(v1, vmask));
+        __m128i t23 = _mm_packs_epi32(_mm_and_si128(v2, vmask), _mm_and_si128(v3, vmask));
+        _mm_storeu_si128((__m128i*)(tags + i), _mm_packus_epi16(t01, t23));
+
+        _mm_storeu_si128((__m128i*)(rows + i), _mm_srl_epi32(v0, shift));
+        _mm_storeu_si128((__m128i*)(rows + i + 4), _mm_srl_epi32(v1, shift));
+        _mm_storeu_si128((__m128i*)(rows + i + 8), _mm_srl_epi32(v2, shift));
+        _mm_storeu_si128((__m128i*)(rows + i + 12), _mm_srl_epi32(v3, shift));
+    }
+#endif
+
+    for (; i < count; i++) {
+        uint32_t v = values[i];
+        tags[i] = v & mask;
+        rows[i] = v >> tagBits;
+    }
+}
+
+size_t table_decode_coded(const struct Table * table, int column, int tagBits, size_t first, size_t count, uint8_t * tags, uint32_t * rows)
+{
+    count = table_decode_column(table, column, first, count, rows);
+    table_split_coded(rows, count, tagBits, tags, rows);
+    return count;
+}
+
+void decode_coded_indexes(const struct CodedIndex * index, const uint32_t * values, size_t count, uint8_t * tables, uint32_t * rows)
+{
+    table_split_coded(values, count, index->tagBits, tables, rows);
+
+    for (size_t i = 0; i < count; i++) {
+        tables[i] = index->tables[tables[i]];
+    }
+}
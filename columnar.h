@@ -0,0 +1,23 @@
+#ifndef _CLRPARSER_COLUMNAR_H_
+#define _CLRPARSER_COLUMNAR_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "table.h"
+
+// bulk decoding of one column of a table into a flat uint32 array, for
+// scans over every row (all MethodDef RVAs, all TypeDef.Extends ...).
+// column is the position in the table, TypeDefColumns::c_Extends etc.
+// rows [first, first + count) are decoded, clipped to the table; returns
+// the number of values written.
+size_t table_decode_column(const struct Table * table, int column, size_t first, size_t count, uint32_t * out);
+
+// same for a coded index column, the low tagBits of every value go to
+// tags and the row index to rows
+size_t table_decode_coded(const struct Table * table, int column, int tagBits, size_t first, size_t count, uint8_t * tags, uint32_t * rows);
+
+// split already decoded coded values, rows may be the values array itself
+void table_split_coded(const uint32_t * values, size_t count, int tagBits, uint8_t * tags, uint32_t * rows);
+
+#endif
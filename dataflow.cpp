@@ -0,0 +1,463 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "dataflow.h"
+#include "il.h"
+
+#define DATAFLOW_ARENA_CHUNK (64 * 1024)
+
+#define LOCAL_USE 1
+#define LOCAL_DEF 2
+
+void dataflow_builder_init(struct DataflowBuilder * builder)
+{
+    arena_init(&builder->scratch, DATAFLOW_ARENA_CHUNK);
+}
+
+void dataflow_builder_free(struct DataflowBuilder * builder)
+{
+    arena_free(&builder->scratch);
+}
+
+// whole words at a time; the loops carry no dependency and vectorize
+
+static inline void set_fill(uint64_t * dst, uint32_t words, uint32_t bits)
+{
+    for (uint32_t i = 0; i < words; i++) {
+        dst[i] = ~(uint64_t)0;
+    }
+    if (bits % 64) {
+        dst[words - 1] = ((uint64_t)1 << (bits % 64)) - 1;
+    }
+}
+
+static inline void set_meet(uint64_t * dst, const uint64_t * src, uint32_t words, int meet)
+{
+    if (meet == DATAFLOW_UNION) {
+        for (uint32_t i = 0; i < words; i++) {
+            dst[i] |= src[i];
+        }
+    } else {
+        for (uint32_t i = 0; i < words; i++) {
+            dst[i] &= src[i];
+        }
+    }
+}
+
+static inline void set_or(uint64_t * dst, const uint64_t * src, uint32_t words)
+{
+    for (uint32_t i = 0; i < words; i++) {
+        dst[i] |= src[i];
+    }
+}
+
+// dst = src, whether dst changed
+static inline int set_assign(uint64_t * dst, const uint64_t * src, uint32_t words)
+{
+    uint64_t changed = 0;
+    for (uint32_t i = 0; i < words; i++) {
+        changed |= dst[i] ^ src[i];
+        dst[i] = src[i];
+    }
+    return changed != 0;
+}
+
+// dst = gen | (src & ~kill), whether dst changed
+static inline int set_transfer(uint64_t * dst, const uint64_t * gen, const uint64_t * src, const uint64_t * kill, uint32_t words)
+{
+    uint64_t changed = 0;
+    for (uint32_t i = 0; i < words; i++) {
+        uint64_t v = gen[i] | (src[i] & ~kill[i]);
+        changed |= dst[i] ^ v;
+        dst[i] = v;
+    }
+    return changed != 0;
+}
+
+// try block to handler edges, CSR both ways like the CFG
+struct HandlerEdges {
+    uint32_t * succStart;
+    uint32_t * succ;
+    uint32_t * predStart;
+    uint32_t * pred;
+};
+
+template <typename Emit>
+static void for_each_handler_edge(const struct ILMethodBody * body, const struct CFG * cfg, Emit emit)
+{
+    struct ILExceptionClause clause;
+    for (uint32_t i = 0; il_method_clause(body, i, &clause) == 0; i++) {
+        int first = cfg_block_at(cfg, clause.tryOffset);
+        int handler = cfg_block_at(cfg, clause.handlerOffset);
+        int filter = (clause.flags & IL_CLAUSE_FILTER) ? cfg_block_at(cfg, clause.filterOffset) : -1;
+        if (first < 0 || handler < 0) {
+            continue;
+        }
+
+        uint32_t end = clause.tryOffset + clause.tryLength;
+        for (uint32_t b = first; b < cfg->blockCount && cfg->blocks[b].start < end; b++) {
+            emit(b, (uint32_t)handler);
+            if (filter >= 0) {
+                emit(b, (uint32_t)filter);
+            }
+        }
+    }
+}
+
+static int handler_edges(struct Arena * scratch, const struct ILMethodBody * body, const struct CFG * cfg, struct HandlerEdges * edges)
+{
+    uint32_t n = cfg->blockCount;
+    edges->succStart = (uint32_t*)arena_alloc(scratch, sizeof(uint32_t) * (n + 1));
+    edges->predStart = (uint32_t*)arena_alloc(scratch, sizeof(uint32_t) * (n + 1));
+    uint32_t * succFill = (uint32_t*)arena_alloc(scratch, sizeof(uint32_t) * (n + 1));
+    uint32_t * predFill = (uint32_t*)arena_alloc(scratch, sizeof(uint32_t) * (n + 1));
+    if (edges->succStart == 0 || edges->predStart == 0 || succFill == 0 || predFill == 0) {
+        return -1;
+    }
+
+    uint32_t count = 0;
+    for_each_handler_edge(body, cfg, [&](uint32_t from, uint32_t to) {
+        edges->succStart[from + 1]++;
+        edges->predStart[to + 1]++;
+        count++;
+    });
+
+    for (uint32_t b = 0; b < n; b++) {
+        edges->succStart[b + 1] += edges->succStart[b];
+        edges->predStart[b + 1] += edges->predStart[b];
+    }
+    memcpy(succFill, edges->succStart, sizeof(uint32_t) * (n + 1));
+    memcpy(predFill, edges->predStart, sizeof(uint32_t) * (n + 1));
+
+    edges->succ = (uint32_t*)arena_alloc(scratch, sizeof(uint32_t) * (count + 1));
+    edges->pred = (uint32_t*)arena_alloc(scratch, sizeof(uint32_t) * (count + 1));
+    if (edges->succ == 0 || edges->pred == 0) {
+        return -1;
+    }
+
+    for_each_handler_edge(body, cfg, [&](uint32_t from, uint32_t to) {
+        edges->succ[succFill[from]++] = to;
+        edges->pred[predFill[to]++] = from;
+    });
+
+    return 0;
+}
+
+struct Worklist {
+    uint32_t * queue;
+    uint8_t * queued;
+    uint32_t head;
+    uint32_t count;
+    uint32_t size;
+};
+
+static inline void worklist_push(struct Worklist * list, uint32_t b)
+{
+    if (!list->queued[b]) {
+        list->queued[b] = 1;
+        list->queue[(list->head + list->count++) % list->size] = b;
+    }
+}
+
+static inline uint32_t worklist_pop(struct Worklist * list)
+{
+    uint32_t b = list->queue[list->head];
+    list->head = (list->head + 1) % list->size;
+    list->count--;
+    list->queued[b] = 0;
+    return b;
+}
+
+int dataflow_solve(struct DataflowBuilder * builder, const struct ILMethodBody * body, const struct CFG * cfg,
+        const struct DataflowProblem * problem, struct Arena * arena, struct DataflowResult * result)
+{
+    struct Arena * scratch = &builder->scratch;
+    arena_reset(scratch);
+
+    uint32_t n = cfg->blockCount;
+    uint32_t bits = problem->bits;
+    uint32_t words = bitset_words(bits);
+    int meet = problem->meet;
+
+    memset(result, 0, sizeof(struct DataflowResult));
+    result->bits = bits;
+    result->words = words;
+    result->blockCount = n;
+
+    size_t setBytes = sizeof(uint64_t) * words;
+    uint64_t * in = (uint64_t*)arena_alloc(arena, setBytes * n + sizeof(uint64_t));
+    uint64_t * out = (uint64_t*)arena_alloc(arena, setBytes * n + sizeof(uint64_t));
+    uint64_t * top = (uint64_t*)arena_alloc(scratch, setBytes + sizeof(uint64_t));
+    uint64_t * tmp = (uint64_t*)arena_alloc(scratch, setBytes + sizeof(uint64_t));
+    uint64_t * empty = (uint64_t*)arena_alloc(scratch, setBytes + sizeof(uint64_t));
+
+    struct Worklist list;
+    list.queue = (uint32_t*)arena_alloc(scratch, sizeof(uint32_t) * (n + 1));
+    list.queued = (uint8_t*)arena_alloc(scratch, n + 1);
+    list.head = 0;
+    list.count = 0;
+    list.size = n;
+
+    if (in == 0 || out == 0 || top == 0 || tmp == 0 || empty == 0 || list.queue == 0 || list.queued == 0) {
+        return -1;
+    }
+    result->in = in;
+    result->out = out;
+
+    struct HandlerEdges edges;
+    memset(&edges, 0, sizeof(struct HandlerEdges));
+    int handlers = (body && meet == DATAFLOW_UNION && body->clauseCount > 0);
+    if (handlers && handler_edges(scratch, body, cfg, &edges) != 0) {
+        return -1;
+    }
+
+    // the identity of the meet, what a block without inputs gets
+    if (meet == DATAFLOW_INTERSECT) {
+        set_fill(top, words, bits);
+        for (uint32_t b = 0; b < n; b++) {
+            memcpy(in + (size_t)b * words, top, setBytes);
+            memcpy(out + (size_t)b * words, top, setBytes);
+        }
+    }
+    const uint64_t * boundary = problem->boundary ? problem->boundary : empty;
+
+    int forward = (problem->direction == DATAFLOW_FORWARD);
+    for (uint32_t i = 0; i < n; i++) {
+        worklist_push(&list, forward ? i : n - 1 - i);
+    }
+
+    while (list.count > 0) {
+        uint32_t b = worklist_pop(&list);
+        uint64_t * bIn = in + (size_t)b * words;
+        uint64_t * bOut = out + (size_t)b * words;
+        const uint64_t * gen = problem->gen + (size_t)b * words;
+        const uint64_t * kill = problem->kill + (size_t)b * words;
+
+        memcpy(tmp, top, setBytes);
+
+        if (forward) {
+            if (b == 0) {
+                set_meet(tmp, boundary, words, meet);
+            }
+            for (uint32_t e = cfg->predStart[b]; e < cfg->predStart[b + 1]; e++) {
+                set_meet(tmp, out + (size_t)cfg->pred[e] * words, words, meet);
+            }
+            if (handlers) {
+                for (uint32_t e = edges.predStart[b]; e < edges.predStart[b + 1]; e++) {
+                    set_or(tmp, in + (size_t)edges.pred[e] * words, words);
+                    set_or(tmp, out + (size_t)edges.pred[e] * words, words);
+                }
+            }
+
+            int changedIn = set_assign(bIn, tmp, words);
+            int changedOut = set_transfer(bOut, gen, bIn, kill, words);
+
+            if (changedOut) {
+                for (uint32_t e = cfg->succStart[b]; e < cfg->succStart[b + 1]; e++) {
+                    worklist_push(&list, cfg->succ[e]);
+                }
+            }
+            if (handlers && (changedIn || changedOut)) {
+                for (uint32_t e = edges.succStart[b]; e < edges.succStart[b + 1]; e++) {
+                    worklist_push(&list, edges.succ[e]);
+                }
+            }
+        } else {
+            if (cfg->succStart[b] == cfg->succStart[b + 1]) {
+                set_meet(tmp, boundary, words, meet);
+            }
+            for (uint32_t e = cfg->succStart[b]; e < cfg->succStart[b + 1]; e++) {
+                set_meet(tmp, in + (size_t)cfg->succ[e] * words, words, meet);
+            }
+            if (handlers) {
+                for (uint32_t e = edges.succStart[b]; e < edges.succStart[b + 1]; e++) {
+                    set_or(tmp, in + (size_t)edges.succ[e] * words, words);
+                }
+            }
+            set_assign(bOut, tmp, words);
+
+            // live into a handler is live all through the try block
+            set_transfer(tmp, gen, bOut, kill, words);
+            if (handlers) {
+                for (uint32_t e = edges.succStart[b]; e < edges.succStart[b + 1]; e++) {
+                    set_or(tmp, in + (size_t)edges.succ[e] * words, words);
+                }
+            }
+
+            if (set_assign(bIn, tmp, words)) {
+                for (uint32_t e = cfg->predStart[b]; e < cfg->predStart[b + 1]; e++) {
+                    worklist_push(&list, cfg->pred[e]);
+                }
+                if (handlers) {
+                    for (uint32_t e = edges.predStart[b]; e < edges.predStart[b + 1]; e++) {
+                        worklist_push(&list, edges.pred[e]);
+                    }
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+// whether insn reads or writes a local, and which
+static int local_access(const struct ILInstruction * insn, uint32_t * local)
+{
+    switch (insn->opcode) {
+        case CEE_LDLOC_0: case CEE_LDLOC_1: case CEE_LDLOC_2: case CEE_LDLOC_3:
+            *local = insn->opcode - CEE_LDLOC_0;
+            return LOCAL_USE;
+        case CEE_LDLOC_S: case CEE_LDLOC: case CEE_LDLOCA_S: case CEE_LDLOCA:
+            *local = insn->operand.var;
+            return LOCAL_USE;
+        case CEE_STLOC_0: case CEE_STLOC_1: case CEE_STLOC_2: case CEE_STLOC_3:
+            *local = insn->opcode - CEE_STLOC_0;
+            return LOCAL_DEF;
+        case CEE_STLOC_S: case CEE_STLOC:
+            *local = insn->operand.var;
+            return LOCAL_DEF;
+        default:
+            return 0;
+    }
+}
+
+// calls visit(block, insn) for every instruction, block by block
+template <typename Visit>
+static int for_each_instruction(const struct ILMethodBody * body, const struct CFG * cfg, Visit visit)
+{
+    for (uint32_t b = 0; b < cfg->blockCount; b++) {
+        struct ILReader reader;
+        il_reader_init(&reader, body->code, cfg->blocks[b].end);
+        reader.offset = cfg->blocks[b].start;
+
+        struct ILInstruction insn;
+        int ret;
+        while ((ret = il_next(&reader, &insn)) > 0) {
+            visit(b, &insn);
+        }
+        if (ret < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static uint32_t local_count(const struct ILMethodBody * body, const struct CFG * cfg)
+{
+    uint32_t count = 0;
+    for_each_instruction(body, cfg, [&](uint32_t, const struct ILInstruction * insn) {
+        uint32_t local;
+        if (local_access(insn, &local) && local + 1 > count) {
+            count = local + 1;
+        }
+    });
+    return count;
+}
+
+int dataflow_liveness(struct DataflowBuilder * builder, const struct ILMethodBody * body, const struct CFG * cfg,
+        struct Arena * arena, struct DataflowResult * result)
+{
+    uint32_t n = cfg->blockCount;
+    uint32_t bits = local_count(body, cfg);
+    uint32_t words = bitset_words(bits);
+
+    // gen and kill outlive the scratch arena, which dataflow_solve resets
+    uint64_t * gen = (uint64_t*)arena_alloc(arena, sizeof(uint64_t) * ((size_t)n * words + 1));
+    uint64_t * kill = (uint64_t*)arena_alloc(arena, sizeof(uint64_t) * ((size_t)n * words + 1));
+    if (gen == 0 || kill == 0) {
+        return -1;
+    }
+
+    // used before it is set in the block, or set
+    int ret = for_each_instruction(body, cfg, [&](uint32_t b, const struct ILInstruction * insn) {
+        uint32_t local;
+        int access = local_access(insn, &local);
+        if (access == LOCAL_USE && !bitset_test(kill + (size_t)b * words, local)) {
+            bitset_set(gen + (size_t)b * words, local);
+        } else if (access == LOCAL_DEF) {
+            bitset_set(kill + (size_t)b * words, local);
+        }
+    });
+    if (ret != 0) {
+        return -1;
+    }
+
+    struct DataflowProblem problem;
+    problem.direction = DATAFLOW_BACKWARD;
+    problem.meet = DATAFLOW_UNION;
+    problem.bits = bits;
+    problem.gen = gen;
+    problem.kill = kill;
+    problem.boundary = 0;
+
+    return dataflow_solve(builder, body, cfg, &problem, arena, result);
+}
+
+int dataflow_reaching_defs(struct DataflowBuilder * builder, const struct ILMethodBody * body, const struct CFG * cfg,
+        struct Arena * arena, struct DataflowResult * result, struct LocalDefs * defs)
+{
+    memset(defs, 0, sizeof(struct LocalDefs));
+
+    uint32_t n = cfg->blockCount;
+    uint32_t locals = local_count(body, cfg);
+
+    uint32_t count = 0;
+    for_each_instruction(body, cfg, [&](uint32_t, const struct ILInstruction * insn) {
+        uint32_t local;
+        count += (local_access(insn, &local) == LOCAL_DEF);
+    });
+
+    uint32_t words = bitset_words(count);
+    uint32_t * offsets = (uint32_t*)arena_alloc(arena, sizeof(uint32_t) * (count + 1));
+    uint16_t * defLocals = (uint16_t*)arena_alloc(arena, sizeof(uint16_t) * (count + 1));
+    uint32_t * defBlocks = (uint32_t*)arena_alloc(&builder->scratch, sizeof(uint32_t) * (count + 1));
+    uint64_t * gen = (uint64_t*)arena_alloc(arena, sizeof(uint64_t) * ((size_t)n * words + 1));
+    uint64_t * kill = (uint64_t*)arena_alloc(arena, sizeof(uint64_t) * ((size_t)n * words + 1));
+    // the definitions of each local
+    uint64_t * defsOf = (uint64_t*)arena_alloc(&builder->scratch, sizeof(uint64_t) * ((size_t)locals * words + 1));
+    if (offsets == 0 || defLocals == 0 || defBlocks == 0 || gen == 0 || kill == 0 || defsOf == 0) {
+        return -1;
+    }
+
+    uint32_t d = 0;
+    int ret = for_each_instruction(body, cfg, [&](uint32_t b, const struct ILInstruction * insn) {
+        uint32_t local;
+        if (local_access(insn, &local) == LOCAL_DEF) {
+            offsets[d] = insn->offset;
+            defLocals[d] = local;
+            defBlocks[d] = b;
+            bitset_set(defsOf + (size_t)local * words, d);
+            d++;
+        }
+    });
+    if (ret != 0) {
+        return -1;
+    }
+
+    // a definition kills every other of its local; the last one in the
+    // block is what the block generates
+    for (d = 0; d < count; d++) {
+        uint64_t * bGen = gen + (size_t)defBlocks[d] * words;
+        uint64_t * bKill = kill + (size_t)defBlocks[d] * words;
+        const uint64_t * all = defsOf + (size_t)defLocals[d] * words;
+        for (uint32_t i = 0; i < words; i++) {
+            bKill[i] |= all[i];
+            bGen[i] &= ~all[i];
+        }
+        bitset_set(bGen, d);
+    }
+
+    defs->count = count;
+    defs->offsets = offsets;
+    defs->locals = defLocals;
+
+    struct DataflowProblem problem;
+    problem.direction = DATAFLOW_FORWARD;
+    problem.meet = DATAFLOW_UNION;
+    problem.bits = count;
+    problem.gen = gen;
+    problem.kill = kill;
+    problem.boundary = 0;
+
+    return dataflow_solve(builder, body, cfg, &problem, arena, result);
+}
@@ -0,0 +1,102 @@
+#ifndef _CLRPARSER_DATAFLOW_H_
+#define _CLRPARSER_DATAFLOW_H_
+
+#include <stdint.h>
+
+#include "arena.h"
+#include "cfg.h"
+#include "il_method.h"
+
+// gen/kill dataflow over the basic blocks of a CFG, solved with a
+// worklist. sets are packed in 64 bit words, per block words apiece:
+// block b's set starts at b * words.
+//
+// a block inside a try block also flows to the handler (and filter) of
+// the clause, at block granularity: forward, what holds at entry or exit
+// of the block reaches the handler; backward, what is live into the
+// handler is live throughout the block. this edge is only taken for
+// DATAFLOW_UNION problems.
+
+#define DATAFLOW_FORWARD    0
+#define DATAFLOW_BACKWARD   1
+
+#define DATAFLOW_UNION      0   // may problems: liveness, reaching definitions
+#define DATAFLOW_INTERSECT  1   // must problems: available expressions
+
+struct DataflowProblem {
+    uint8_t direction;          // DATAFLOW_FORWARD or DATAFLOW_BACKWARD
+    uint8_t meet;               // DATAFLOW_UNION or DATAFLOW_INTERSECT
+    uint32_t bits;
+    const uint64_t * gen;       // per block
+    const uint64_t * kill;
+    const uint64_t * boundary;  // into the entry block, or out of exits when backward; 0 for none
+};
+
+struct DataflowResult {
+    uint32_t bits;
+    uint32_t words;             // per block
+    uint32_t blockCount;
+    const uint64_t * in;        // at block entry
+    const uint64_t * out;       // at block exit
+};
+
+// local variable definitions, numbered in code order; the bits of
+// dataflow_reaching_defs
+struct LocalDefs {
+    uint32_t count;
+    const uint32_t * offsets;   // of the stloc
+    const uint16_t * locals;
+};
+
+// scratch memory reused from one method to the next
+struct DataflowBuilder {
+    struct Arena scratch;
+};
+
+void dataflow_builder_init(struct DataflowBuilder * builder);
+void dataflow_builder_free(struct DataflowBuilder * builder);
+
+// the fixed point of problem over cfg, the graph of body; body may be 0
+// to leave exception handlers out. sets are allocated from arena.
+int dataflow_solve(struct DataflowBuilder * builder, const struct ILMethodBody * body, const struct CFG * cfg,
+        const struct DataflowProblem * problem, struct Arena * arena, struct DataflowResult * result);
+
+// live local variables, bit n for local n. ldloca counts as a use.
+int dataflow_liveness(struct DataflowBuilder * builder, const struct ILMethodBody * body, const struct CFG * cfg,
+        struct Arena * arena, struct DataflowResult * result);
+
+// stloc instructions reaching each block, bit n for defs->offsets[n]
+int dataflow_reaching_defs(struct DataflowBuilder * builder, const struct ILMethodBody * body, const struct CFG * cfg,
+        struct Arena * arena, struct DataflowResult * result, struct LocalDefs * defs);
+
+static inline uint32_t bitset_words(uint32_t bits)
+{
+    return (bits + 63) / 64;
+}
+
+static inline int bitset_test(const uint64_t * set, uint32_t bit)
+{
+    return (set[bit / 64] >> (bit % 64)) & 1;
+}
+
+static inline void bitset_set(uint64_t * set, uint32_t bit)
+{
+    set[bit / 64] |= (uint64_t)1 << (bit % 64);
+}
+
+static inline void bitset_clear(uint64_t * set, uint32_t bit)
+{
+    set[bit / 64] &= ~((uint64_t)1 << (bit % 64));
+}
+
+static inline const uint64_t * dataflow_in(const struct DataflowResult * result, uint32_t block)
+{
+    return result->in + (size_t)block * result->words;
+}
+
+static inline const uint64_t * dataflow_out(const struct DataflowResult * result, uint32_t block)
+{
+    return result->out + (size_t)block * result->words;
+}
+
+#endif
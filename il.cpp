@@ -0,0 +1,181 @@
+#include "il.h"
+
+#include <string.h>
+#include <stdint.h>
+
+#include "userstring.h"
+
+static inline uint32_t read_u32(const char * ptr)
+{
+    uint32_t v;
+    memcpy(&v, ptr, 4);
+    return v;
+}
+
+int il_decode(const char * code, uint32_t size, uint32_t offset, struct ILInstruction * insn)
+{
+    if (offset >= size) {
+        return -1;
+    }
+
+    const char * ptr = code + offset;
+    uint32_t left = size - offset;
+
+    // opcode_info looks at the second byte after 0xFE
+    if ((unsigned char)ptr[0] == 0xFE && left < 2) {
+        return -1;
+    }
+
+    int length;
+    const struct OpCodeInfo * info = opcode_info(ptr, &length);
+    if (info == 0 || left - length < info->size) {
+        return -1;
+    }
+
+    insn->offset = offset;
+    insn->opcode = info->index;
+    insn->operandKind = info->operand;
+    insn->opcodeSize = length;
+    insn->flow = info->flow;
+    insn->operand.i = 0;
+    insn->targets = 0;
+
+    ptr += length;
+    left -= length;
+
+    uint32_t operandSize = info->size;
+
+    switch (info->operand) {
+        case ShortInlineBrTarget:
+        case ShortInlineI:
+            insn->operand.i = (int8_t)ptr[0];
+            break;
+        case ShortInlineVar:
+            insn->operand.var = (uint8_t)ptr[0];
+            break;
+        case InlineVar: {
+            uint16_t v;
+            memcpy(&v, ptr, 2);
+            insn->operand.var = v;
+            break;
+        }
+        case InlineI:
+        case InlineBrTarget:
+            insn->operand.i = (int32_t)read_u32(ptr);
+            break;
+        case InlineI8:
+            memcpy(&insn->operand.i, ptr, 8);
+            break;
+        case ShortInlineR: {
+            float r;
+            memcpy(&r, ptr, 4);
+            insn->operand.r = r;
+            break;
+        }
+        case InlineR:
+            memcpy(&insn->operand.r, ptr, 8);
+            break;
+        case InlineSwitch: {
+            uint32_t count = read_u32(ptr);
+            if (count > (left - 4) / 4) {
+                return -1;
+            }
+            insn->operand.count = count;
+            insn->targets = ptr + 4;
+            operandSize += 4 * count;
+            break;
+        }
+        case InlineField:
+        case InlineMethod:
+        case InlineSig:
+        case InlineString:
+        case InlineTok:
+        case InlineType:
+            insn->operand.token = read_u32(ptr);
+            break;
+        default:
+            break;
+    }
+
+    insn->size = length + operandSize;
+
+    return 0;
+}
+
+// operands are shown as they are encoded, branch offsets relative
+void il_print(struct Context * context, struct Output * out, const struct ILInstruction * insn)
+{
+    output_begin(out, "insn");
+    output_meta_u64(out, "offset", insn->offset);
+    output_text(out, "  ");
+    output_field_str(out, "opcode", il_name(insn));
+
+    switch (insn->operandKind) {
+        case ShortInlineBrTarget:
+        case ShortInlineI:
+            output_text(out, " ");
+            output_field_u64(out, "operand", (uint8_t)insn->operand.i);
+            break;
+        case ShortInlineVar:
+        case InlineVar:
+            output_text(out, " ");
+            output_field_u64(out, "operand", insn->operand.var);
+            break;
+        case InlineI:
+        case InlineBrTarget:
+            output_text(out, " ");
+            output_field_u64(out, "operand", (uint32_t)insn->operand.i);
+            break;
+        case InlineSwitch:
+            output_text(out, " ");
+            output_field_u64(out, "count", insn->operand.count);
+            output_text(out, " (");
+            output_array_begin(out, "targets");
+            for (uint32_t i = 0; i < insn->operand.count; i++) {
+                int32_t delta;
+                memcpy(&delta, insn->targets + 4 * (size_t)i, 4);
+                if (i != 0) {
+                    output_text(out, ", ");
+                }
+                output_item_i64(out, delta);
+            }
+            output_array_end(out);
+            output_text(out, ")");
+            break;
+        case InlineString: {
+            uint32_t len;
+            const char * str = context ? clr_user_string(context, insn->operand.token, &len, 0) : 0;
+            output_text(out, " ");
+            if (str == 0) {
+                output_field_hex(out, "token", insn->operand.token, 0, OUTPUT_UPPER);
+                break;
+            }
+            output_meta_u64(out, "token", insn->operand.token);
+            output_text(out, "\"");
+            output_field_line(out, "string", str, len);
+            output_text(out, "\"");
+            break;
+        }
+        case InlineField:
+        case InlineMethod:
+        case InlineSig:
+        case InlineTok:
+        case InlineType:
+            output_text(out, " ");
+            output_field_hex(out, "token", insn->operand.token, 0, OUTPUT_UPPER);
+            break;
+        case InlineI8:
+            output_text(out, " ");
+            output_field_u64(out, "operand", (uint64_t)insn->operand.i);
+            break;
+        case ShortInlineR:
+        case InlineR:
+            output_text(out, " ");
+            output_field_double(out, "operand", insn->operand.r);
+            break;
+        default:
+            break;
+    }
+
+    output_end(out);
+}
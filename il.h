@@ -0,0 +1,102 @@
+#ifndef _CLRPARSER_IL_H_
+#define _CLRPARSER_IL_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "opcode.h"
+#include "output.h"
+
+// ECMA-335 III instruction stream of a method body, decoded one
+// instruction at a time into a caller owned record without allocating;
+// the operand list of switch stays in the body and is read through
+// il_switch_target.
+
+struct ILInstruction {
+    uint32_t offset;        // from the start of the code
+    uint32_t size;          // opcode and operand bytes
+    uint16_t opcode;        // index into opCodes
+    uint8_t operandKind;    // OperandParams
+    uint8_t opcodeSize;     // 1, or 2 after the 0xFE prefix
+    uint8_t flow;           // OpCodeFlow
+    union {
+        int64_t i;          // InlineI, InlineI8, ShortInlineI and branch offsets, sign extended
+        uint32_t var;       // InlineVar, ShortInlineVar
+        uint32_t token;     // InlineField, InlineMethod, InlineSig, InlineString, InlineTok, InlineType
+        uint32_t count;     // InlineSwitch
+        double r;           // InlineR, ShortInlineR
+    } operand;
+    const char * targets;   // InlineSwitch, count little endian int32 offsets
+};
+
+// the instruction at offset of code, 0 or -1 if it is no opcode or its
+// operand runs past size
+int il_decode(const char * code, uint32_t size, uint32_t offset, struct ILInstruction * insn);
+
+struct ILReader {
+    const char * code;
+    uint32_t size;
+    uint32_t offset;
+};
+
+static inline void il_reader_init(struct ILReader * reader, const char * code, uint32_t size)
+{
+    reader->code = code;
+    reader->size = size;
+    reader->offset = 0;
+}
+
+// the next instruction: 1, 0 at the end of the code, -1 if it does not
+// decode, after which the reader stays put
+static inline int il_next(struct ILReader * reader, struct ILInstruction * insn)
+{
+    if (reader->offset >= reader->size) {
+        return 0;
+    }
+    if (il_decode(reader->code, reader->size, reader->offset, insn) != 0) {
+        return -1;
+    }
+    reader->offset += insn->size;
+    return 1;
+}
+
+// code offset a branch goes to, relative offsets count from the next
+// instruction
+static inline int64_t il_branch_target(const struct ILInstruction * insn)
+{
+    return (int64_t)insn->offset + insn->size + insn->operand.i;
+}
+
+static inline int64_t il_switch_target(const struct ILInstruction * insn, uint32_t n)
+{
+    int32_t delta;
+    memcpy(&delta, insn->targets + 4 * (size_t)n, 4);
+    return (int64_t)insn->offset + insn->size + delta;
+}
+
+// whether the instruction ends the path through the method: ret, throw,
+// rethrow, endfinally, endfilter, and jmp which opcode.def calls a call
+static inline int il_is_exit(const struct ILInstruction * insn)
+{
+    return insn->flow == FLOW_RETURN || insn->flow == FLOW_THROW || insn->opcode == CEE_JMP;
+}
+
+static inline int il_falls_through(const struct ILInstruction * insn)
+{
+    return insn->flow != FLOW_BRANCH && !il_is_exit(insn);
+}
+
+struct Context;
+
+// one instruction per line, "  name operand" in text. with a context,
+// ldstr shows its literal, escaped onto the line, and keeps the token as
+// meta data; without one, or if the token is no string, the token is shown.
+void il_print(struct Context * context, struct Output * out, const struct ILInstruction * insn);
+
+static inline const char * il_name(const struct ILInstruction * insn)
+{
+    return opCodes[insn->opcode].name;
+}
+
+#endif
@@ -0,0 +1,173 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "il_method.h"
+#include "pe.h"
+
+#define TINY_CLAUSE_SIZE 12
+#define FAT_CLAUSE_SIZE 24
+
+static inline uint16_t read_u16(const char * ptr)
+{
+    uint16_t v;
+    memcpy(&v, ptr, 2);
+    return v;
+}
+
+static inline uint32_t read_u32(const char * ptr)
+{
+    uint32_t v;
+    memcpy(&v, ptr, 4);
+    return v;
+}
+
+static void read_clause(const struct ILClauseSection * section, uint32_t n, struct ILExceptionClause * clause)
+{
+    if (section->fat) {
+        const char * ptr = section->data + (size_t)n * FAT_CLAUSE_SIZE;
+        clause->flags = read_u32(ptr);
+        clause->tryOffset = read_u32(ptr + 4);
+        clause->tryLength = read_u32(ptr + 8);
+        clause->handlerOffset = read_u32(ptr + 12);
+        clause->handlerLength = read_u32(ptr + 16);
+        clause->classToken = read_u32(ptr + 20);
+    } else {
+        const char * ptr = section->data + (size_t)n * TINY_CLAUSE_SIZE;
+        clause->flags = read_u16(ptr);
+        clause->tryOffset = read_u16(ptr + 2);
+        clause->tryLength = (uint8_t)ptr[4];
+        clause->handlerOffset = read_u16(ptr + 5);
+        clause->handlerLength = (uint8_t)ptr[7];
+        clause->classToken = read_u32(ptr + 8);
+    }
+    clause->filterOffset = clause->flags & IL_CLAUSE_FILTER ? clause->classToken : 0;
+}
+
+static int in_code(const struct ILMethodBody * body, uint32_t offset, uint32_t length)
+{
+    return offset <= body->codeSize && length <= body->codeSize - offset;
+}
+
+// the sections following the code, 4 byte aligned
+static int read_sections(struct PEFile * file, uint32_t RVA, struct ILMethodBody * body)
+{
+    uint8_t kind = IL_SECT_MORE_SECTS;
+
+    while (kind & IL_SECT_MORE_SECTS) {
+        RVA = (RVA + 3) & ~3u;
+
+        const char * ptr = find_virtual_range(file, RVA, 4);
+        if (ptr == 0) {
+            return -1;
+        }
+
+        kind = ptr[0];
+        int fat = (kind & IL_SECT_FAT_FORMAT) != 0;
+        uint32_t dataSize = fat ? read_u32(ptr) >> 8 : (uint8_t)ptr[1];
+        if (dataSize < 4 || find_virtual_range(file, RVA, dataSize) == 0) {
+            return -1;
+        }
+
+        if (kind & IL_SECT_EHTABLE) {
+            if (body->sectionCount == IL_METHOD_MAX_SECTIONS) {
+                return -1;
+            }
+            struct ILClauseSection * section = body->sections + body->sectionCount++;
+            section->data = ptr + 4;
+            section->count = (dataSize - 4) / (fat ? FAT_CLAUSE_SIZE : TINY_CLAUSE_SIZE);
+            section->fat = fat;
+            body->clauseCount += section->count;
+        }
+
+        RVA += dataSize;
+    }
+
+    return 0;
+}
+
+int il_method_body(struct PEFile * file, uint32_t RVA, struct ILMethodBody * body)
+{
+    memset(body, 0, sizeof(struct ILMethodBody));
+
+    const char * ptr = find_virtual_range(file, RVA, 1);
+    if (ptr == 0) {
+        return -1;
+    }
+    body->header = ptr;
+
+    if ((ptr[0] & 0x3) == IL_METHOD_TINY) {
+        body->flags = IL_METHOD_TINY;
+        body->headerSize = 1;
+        body->maxStack = 8;
+        body->codeSize = (uint8_t)ptr[0] >> 2;
+    } else if ((ptr[0] & 0x3) == IL_METHOD_FAT) {
+        ptr = find_virtual_range(file, RVA, 12);
+        if (ptr == 0) {
+            return -1;
+        }
+        uint16_t flags = read_u16(ptr);
+        body->flags = flags & 0x0FFF;
+        body->headerSize = (flags >> 12) * 4;
+        body->maxStack = read_u16(ptr + 2);
+        body->codeSize = read_u32(ptr + 4);
+        body->localVarSigTok = read_u32(ptr + 8);
+        if (body->headerSize < 12) {
+            return -1;
+        }
+    } else {
+        return -1;
+    }
+
+    uint64_t codeRVA = (uint64_t)RVA + body->headerSize;
+    body->code = find_virtual_range(file, codeRVA, body->codeSize);
+    if (body->code == 0) {
+        return -1;
+    }
+
+    if (body->flags & IL_METHOD_MORE_SECTS) {
+        if (read_sections(file, (uint32_t)(codeRVA + body->codeSize), body) != 0) {
+            return -1;
+        }
+    }
+
+    struct ILExceptionClause clause;
+    for (uint32_t i = 0; i < body->clauseCount; i++) {
+        il_method_clause(body, i, &clause);
+        if (!in_code(body, clause.tryOffset, clause.tryLength) || !in_code(body, clause.handlerOffset, clause.handlerLength)) {
+            return -1;
+        }
+        if ((clause.flags & IL_CLAUSE_FILTER) && clause.filterOffset >= body->codeSize) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int clr_method_body(struct Context * context, uint32_t methodDef, struct ILMethodBody * body)
+{
+    if (methodDef == 0 || methodDef > (uint32_t)context->tables[MethodDef].rowCount) {
+        return -1;
+    }
+
+    uint32_t RVA = Row<MethodDef>(context->tables, methodDef - 1).RVA();
+    if (RVA == 0) {
+        memset(body, 0, sizeof(struct ILMethodBody));
+        return -1;
+    }
+
+    return il_method_body(context->file, RVA, body);
+}
+
+int il_method_clause(const struct ILMethodBody * body, uint32_t index, struct ILExceptionClause * clause)
+{
+    for (uint32_t i = 0; i < body->sectionCount; i++) {
+        if (index < body->sections[i].count) {
+            read_clause(body->sections + i, index, clause);
+            return 0;
+        }
+        index -= body->sections[i].count;
+    }
+
+    return -1;
+}
@@ -0,0 +1,73 @@
+#ifndef _CLRPARSER_IL_METHOD_H_
+#define _CLRPARSER_IL_METHOD_H_
+
+#include <stdint.h>
+
+#include "clr.h"
+
+// ECMA-335 II.25.4 method bodies. the header, the code and the exception
+// handling sections are checked against the section holding the body and
+// left where they are in the image; clauses are decoded from there on
+// request.
+
+#define IL_METHOD_TINY          0x2
+#define IL_METHOD_FAT           0x3
+#define IL_METHOD_MORE_SECTS    0x8
+#define IL_METHOD_INIT_LOCALS   0x10
+
+#define IL_SECT_EHTABLE         0x1
+#define IL_SECT_OPTILTABLE      0x2
+#define IL_SECT_FAT_FORMAT      0x40
+#define IL_SECT_MORE_SECTS      0x80
+
+#define IL_CLAUSE_EXCEPTION     0x0
+#define IL_CLAUSE_FILTER        0x1
+#define IL_CLAUSE_FINALLY       0x2
+#define IL_CLAUSE_FAULT         0x4
+
+// exception handling sections of one body, more than this is taken to be
+// malformed
+#define IL_METHOD_MAX_SECTIONS  4
+
+struct ILClauseSection {
+    const char * data;      // first clause
+    uint32_t count;
+    uint8_t fat;            // 24 byte clauses, 12 byte ones otherwise
+};
+
+struct ILMethodBody {
+    const char * header;
+    uint16_t flags;         // IL_METHOD_*, the format included
+    uint16_t headerSize;    // bytes
+    uint16_t maxStack;      // 8 for tiny bodies
+    uint32_t localVarSigTok;
+
+    const char * code;
+    uint32_t codeSize;
+
+    uint32_t clauseCount;   // over all sections
+    uint32_t sectionCount;
+    struct ILClauseSection sections[IL_METHOD_MAX_SECTIONS];
+};
+
+struct ILExceptionClause {
+    uint32_t flags;         // IL_CLAUSE_*
+    uint32_t tryOffset;
+    uint32_t tryLength;
+    uint32_t handlerOffset;
+    uint32_t handlerLength;
+    uint32_t classToken;    // IL_CLAUSE_EXCEPTION
+    uint32_t filterOffset;  // IL_CLAUSE_FILTER
+};
+
+// the body at RVA, 0 or -1 if it is not in the image or malformed. clause
+// ranges are checked to lie in the code.
+int il_method_body(struct PEFile * file, uint32_t RVA, struct ILMethodBody * body);
+
+// the body of a MethodDef row, -1 also for methods without one (RVA 0)
+int clr_method_body(struct Context * context, uint32_t methodDef, struct ILMethodBody * body);
+
+// clause index of all sections in order, 0 or -1 if out of range
+int il_method_clause(const struct ILMethodBody * body, uint32_t index, struct ILExceptionClause * clause);
+
+#endif
@@ -0,0 +1,236 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "lookup.h"
+#include "columnar.h"
+
+// key column of the tables ECMA-335 II.22 requires to be sorted, -1 for
+// the rest. the Sorted bit vector of a file says which of them really are.
+static int sorted_key_column(int table)
+{
+    switch(table) {
+        case ClassLayout:            return ClassLayoutColumns::c_Parent;
+        case Constant:               return ConstantColumns::c_Parent;
+        case CustomAttribute:        return CustomAttributeColumns::c_Parent;
+        case DeclSecurity:           return DeclSecurityColumns::c_Parent;
+        case FieldLayout:            return FieldLayoutColumns::c_Field;
+        case FieldMarshal:           return FieldMarshalColumns::c_Parent;
+        case FieldRVA:               return FieldRVAColumns::c_Field;
+        case GenericParam:           return GenericParamColumns::c_Owner;
+        case GenericParamConstraint: return GenericParamConstraintColumns::c_Owner;
+        case ImplMap:                return ImplMapColumns::c_MemberForwarded;
+        case InterfaceImpl:          return InterfaceImplColumns::c_Class;
+        case MethodImpl:             return MethodImplColumns::c_Class;
+        case MethodSemantics:        return MethodSemanticsColumns::c_Association;
+        case NestedClass:            return NestedClassColumns::c_NestedClass;
+        default:                     return -1;
+    }
+}
+
+static inline uint32_t cell_u32(const struct Table * table, uint32_t row, int column)
+{
+    const char * ptr = table->ptr + table->cellSize * row + table->offset[column];
+    return (table->width[column] == 4) ? *(const uint32_t*)ptr : *(const uint16_t*)ptr;
+}
+
+// a column in sorted order: keys ascending, rows the table row of every
+// key or 0 when the column already was in order
+struct RowIndex {
+    uint32_t * keys;
+    uint32_t * rows;
+};
+
+struct LookupCache {
+    struct RowIndex * index[64][TABLE_MAX_COLUMNS];
+};
+
+static struct RowIndex * build_index(const struct Table * table, int column)
+{
+    size_t count = table->rowCount;
+
+    struct RowIndex * index = (struct RowIndex*)malloc(sizeof(struct RowIndex));
+    index->keys = (uint32_t*)malloc(sizeof(uint32_t) * (count ? count : 1));
+    index->rows = 0;
+
+    table_decode_column(table, column, 0, count, index->keys);
+
+    size_t i = 1;
+    while (i < count && index->keys[i - 1] <= index->keys[i]) {
+        i++;
+    }
+
+    if (i >= count) {
+        return index;
+    }
+
+    // key in the high half, row in the low half, so ties keep row order
+    uint64_t * pairs = (uint64_t*)malloc(sizeof(uint64_t) * count);
+    for (i = 0; i < count; i++) {
+        pairs[i] = ((uint64_t)index->keys[i] << 32) | i;
+    }
+
+    std::sort(pairs, pairs + count);
+
+    index->rows = (uint32_t*)malloc(sizeof(uint32_t) * count);
+    for (i = 0; i < count; i++) {
+        index->keys[i] = pairs[i] >> 32;
+        index->rows[i] = (uint32_t)pairs[i];
+    }
+
+    free(pairs);
+
+    return index;
+}
+
+static void free_index(struct RowIndex * index)
+{
+    if (index) {
+        free(index->keys);
+        free(index->rows);
+        free(index);
+    }
+}
+
+// concurrent first users may both build, the loser frees its copy
+static struct RowIndex * get_index(struct Context * context, int table, int column)
+{
+    struct LookupCache * cache = __atomic_load_n(&context->lookups, __ATOMIC_ACQUIRE);
+    if (cache == 0) {
+        struct LookupCache * fresh = (struct LookupCache*)calloc(1, sizeof(struct LookupCache));
+        if (__atomic_compare_exchange_n(&context->lookups, &cache, fresh, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            cache = fresh;
+        } else {
+            free(fresh);
+        }
+    }
+
+    struct RowIndex ** slot = &cache->index[table][column];
+    struct RowIndex * index = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+    if (index == 0) {
+        struct RowIndex * fresh = build_index(context->tables + table, column);
+        if (__atomic_compare_exchange_n(slot, &index, fresh, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            index = fresh;
+        } else {
+            free_index(fresh);
+        }
+    }
+
+    return index;
+}
+
+// a table the file does not have comes back with a null ptr and no rows
+static int get_table(struct Context * context, int table, int column, const struct Table ** t)
+{
+    if (table < 0 || table >= 64 || column < 0 || column >= TABLE_MAX_COLUMNS) {
+        return -1;
+    }
+
+    *t = context->tables + table;
+    if ((*t)->fields == 0) {
+        return 0;
+    }
+
+    for (int i = 0; i <= column; i++) {
+        if ((*t)->fields[i].type == 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int clr_lookup_rows(struct Context * context, int table, int column, uint32_t key, struct RowRange * range)
+{
+    range->rows = 0;
+    range->first = 0;
+    range->count = 0;
+
+    const struct Table * t = 0;
+    if (get_table(context, table, column, &t) != 0) {
+        return -1;
+    }
+
+    if (t->ptr == 0) {
+        return 0;
+    }
+
+    uint32_t lo = 0, hi = t->rowCount;
+
+    if (column == sorted_key_column(table) && (context->Sorted & ((uint64_t)1 << table))) {
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            if (cell_u32(t, mid, column) < key) lo = mid + 1; else hi = mid;
+        }
+
+        uint32_t end = lo;
+        hi = t->rowCount;
+        while (end < hi) {
+            uint32_t mid = end + (hi - end) / 2;
+            if (cell_u32(t, mid, column) <= key) end = mid + 1; else hi = mid;
+        }
+
+        range->first = lo;
+        range->count = end - lo;
+        return 0;
+    }
+
+    struct RowIndex * index = get_index(context, table, column);
+
+    const uint32_t * keys = index->keys;
+    const uint32_t * first = std::lower_bound(keys, keys + t->rowCount, key);
+    const uint32_t * last = std::upper_bound(first, keys + t->rowCount, key);
+
+    range->rows = index->rows;
+    range->first = first - keys;
+    range->count = last - first;
+
+    return 0;
+}
+
+int clr_lookup_owned(struct Context * context, int table, int column, int ownerTable, uint32_t ownerRow, struct RowRange * range)
+{
+    range->rows = 0;
+    range->first = 0;
+    range->count = 0;
+
+    const struct Table * t = 0;
+    if (get_table(context, table, column, &t) != 0) {
+        return -1;
+    }
+
+    if (t->ptr == 0) {
+        return 0;
+    }
+
+    if (t->fields[column].type != 'I') {
+        return -1;
+    }
+
+    uint32_t key;
+    if (encode_coded_index((const struct CodedIndex*)t->fields[column].ctx, ownerTable, ownerRow, &key) != 0) {
+        return 0;
+    }
+
+    return clr_lookup_rows(context, table, column, key, range);
+}
+
+void lookup_free(struct Context * context)
+{
+    struct LookupCache * cache = context->lookups;
+    if (cache == 0) {
+        return;
+    }
+
+    for (int i = 0; i < 64; i++) {
+        for (int j = 0; j < TABLE_MAX_COLUMNS; j++) {
+            free_index(cache->index[i][j]);
+        }
+    }
+
+    free(cache);
+    context->lookups = 0;
+}
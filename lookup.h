@@ -0,0 +1,36 @@
+#ifndef _CLRPARSER_LOOKUP_H_
+#define _CLRPARSER_LOOKUP_H_
+
+#include <stdint.h>
+
+#include "clr.h"
+
+// rows of a table whose column holds one value, see clr_lookup_rows
+struct RowRange {
+    const uint32_t * rows; // 0 if the table itself is in column order
+    uint32_t first;
+    uint32_t count;
+};
+
+// 1 based row number of the i-th match
+static inline uint32_t row_range_at(const struct RowRange * range, uint32_t i) {
+    uint32_t n = range->first + i;
+    return (range->rows ? range->rows[n] : n) + 1;
+}
+
+// all rows of table whose column equals key, the raw value as stored (a
+// coded index still carries its tag). tables flagged in the Sorted bit
+// vector are binary searched in place on their key column (Constant.Parent,
+// CustomAttribute.Parent, NestedClass.NestedClass, GenericParam.Owner ...).
+// any other column gets a sorted permutation of the table, built on first
+// use and kept until close_clr. safe to call from several threads.
+// returns 0, or -1 if table or column do not exist.
+int clr_lookup_rows(struct Context * context, int table, int column, uint32_t key, struct RowRange * range);
+
+// the same keyed by the owner, e.g. the CustomAttribute rows of
+// (TypeDef, 3); the owner is encoded for the column's index kind first.
+int clr_lookup_owned(struct Context * context, int table, int column, int ownerTable, uint32_t ownerRow, struct RowRange * range);
+
+void lookup_free(struct Context * context);
+
+#endif
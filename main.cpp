@@ -4,36 +4,340 @@
 #include <errno.h>
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
 #include <stdint.h>
 #include <stdarg.h>
+#include <pthread.h>
 
 #include "clr.h"
 #include "pe.h"
+#include "pool.h"
+#include "archive.h"
+#include "cache.h"
+#include "userstring.h"
+#include "output.h"
 
 #include "opcode.h"
 
-static void work(const char * filename);
+struct FileList {
+	const char ** names;
+	int count;
+	int size;
+};
+
+static int work(const char * filename, FILE * out);
+static int work_archive(const char * filename, FILE * out);
+static void batch(const char ** files, int count, int threads);
+static void add_file(struct FileList * list, const char * name);
+static void free_file_list(struct FileList * list);
+static int read_file_list(struct FileList * list, const char * listname);
+
+static int loadMode = PE_LOAD_MMAP;
+static const char * cacheDir = 0;
+static uint64_t cacheLimit = CLR_CACHE_DEFAULT_LIMIT;
+static int dumpStrings = 0;
+static int dumpThreads = 1;
+static int outputFormat = OUTPUT_TEXT;
+
+static void usage(const char * name)
+{
+	fprintf(stderr, "usage: %s [-p] [-s] [-J] [-c cachedir [-C megabytes]] [-j threads] [-l listfile] file...\n", name);
+	fprintf(stderr, "  .nupkg and .zip files are dumped member by member without extracting them\n");
+	fprintf(stderr, "  -p      partial loading, only read headers, metadata and method bodies\n");
+	fprintf(stderr, "  -s      print the string literals instead, one ldstr token and text per line\n");
+	fprintf(stderr, "  -J      write JSON lines, one object per line of the text output\n");
+	fprintf(stderr, "  -c D    keep parsed metadata layouts in directory D\n");
+	fprintf(stderr, "  -C N    evict cached layouts once D grows beyond N megabytes\n");
+	fprintf(stderr, "  -j N    dump the files on N threads, 0 for one per cpu; a single file has its methods split instead\n");
+	fprintf(stderr, "  -l F    also dump every file named in F, one path per line\n");
+}
 
 int main(int argc, const char * argv[])
 {
-    for(int i = 1; i < argc; i++) {
-        work(argv[i]);
-    }
-    return 0;
+	int threads = 1;
+
+	struct FileList files = {0, 0, 0};
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+			threads = atoi(argv[++i]);
+			if (threads <= 0) {
+				threads = pool_cpu_count();
+			}
+		} else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+			cacheDir = argv[++i];
+		} else if (strcmp(argv[i], "-C") == 0 && i + 1 < argc) {
+			cacheLimit = (uint64_t)atoll(argv[++i]) * 1024 * 1024;
+		} else if (strcmp(argv[i], "-p") == 0) {
+			loadMode = PE_LOAD_PARTIAL;
+		} else if (strcmp(argv[i], "-s") == 0) {
+			dumpStrings = 1;
+		} else if (strcmp(argv[i], "-J") == 0) {
+			outputFormat = OUTPUT_JSON;
+		} else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+			if (read_file_list(&files, argv[++i]) != 0) {
+				fprintf(stderr, "read file list %s failed\n", argv[i]);
+				return -1;
+			}
+		} else if (argv[i][0] == '-' && argv[i][1] != 0) {
+			usage(argv[0]);
+			return -1;
+		} else {
+			add_file(&files, argv[i]);
+		}
+	}
+
+	if (threads > 1 && files.count == 1) {
+		dumpThreads = threads;
+		if (work(files.names[0], stdout) != 0) {
+			assert(0);
+		}
+	} else if (threads > 1) {
+		batch(files.names, files.count, threads);
+	} else {
+		for (int i = 0; i < files.count; i++) {
+			if (work(files.names[i], stdout) != 0) {
+				assert(0);
+			}
+		}
+	}
+
+	free_file_list(&files);
+
+	return 0;
+}
+
+// control characters are escaped so every literal stays on its line
+static int print_string(void * arg, uint32_t offset, const char * utf8, uint32_t len, int)
+{
+	struct Output * out = (struct Output*)arg;
+
+	output_begin(out, "string");
+	output_field_hex(out, "token", USER_STRING_TOKEN | offset, 8, OUTPUT_UPPER);
+	output_text(out, "\t");
+	output_field_line(out, "text", utf8, len);
+	output_end(out);
+
+	return 0;
 }
 
-static void work(const char * filename) 
+static void print_failed(FILE * out, const char * name, size_t len, const char * error)
 {
+	struct Output output;
+	output_init(&output, out, outputFormat);
+	output_begin(&output, "failed");
+	output_text(&output, "# ");
+	output_field_strn(&output, "file", name, len);
+	output_text(&output, ": ");
+	output_field_str(&output, "error", error);
+	output_end(&output);
+	output_free(&output);
+}
+
+static int dump(struct PEFile * pe, FILE * out)
+{
+	struct Context context;
+
+	if (read_clr_cached(&context, pe, cacheDir, cacheLimit) != 0) {
+		return -1;
+	}
+
+	context.out = out;
+	context.format = outputFormat;
+
+	if (dumpStrings) {
+		struct Output output;
+		output_init(&output, out, outputFormat);
+		clr_for_each_user_string(&context, print_string, &output);
+		output_free(&output);
+	} else {
+		clr_dump_type_parallel(&context, dumpThreads);
+	}
+
+	close_clr(&context);
+
+	return 0;
+}
+
+static int has_suffix(const char * name, const char * suffix)
+{
+	size_t len = strlen(name);
+	size_t n = strlen(suffix);
+	return len >= n && strcasecmp(name + len - n, suffix) == 0;
+}
+
+static int work(const char * filename, FILE * out)
+{
+	if (has_suffix(filename, ".nupkg") || has_suffix(filename, ".zip")) {
+		return work_archive(filename, out);
+	}
+
 	struct PEFile pe;
-	if (read_pe_file(&pe, filename) != 0) {
-		assert(0);
+	if (read_pe_file_mode(&pe, filename, loadMode) != 0) {
+		return -1;
 	}
-	
-	struct Context context;
 
-	if (read_clr(&context, &pe) != 0) {
-		assert(0);
+	int ret = dump(&pe, out);
+
+	close_pe_file(&pe);
+
+	return ret;
+}
+
+// every .dll and .exe member is parsed straight from the archive mapping
+// when it is stored, or from the archive's inflate buffer when deflated
+static int work_archive(const char * filename, FILE * out)
+{
+	struct archive * archive = archive_open(filename);
+	if (archive == 0) {
+		return -1;
 	}
 
-	clr_dump_type(&context);
+	for (int i = 0; i < archive_count(archive); i++) {
+		const struct archive_entry * entry = archive_get_entry(archive, i);
+		if (!archive_entry_has_suffix(entry, ".dll") && !archive_entry_has_suffix(entry, ".exe")) {
+			continue;
+		}
+
+		struct Output output;
+		output_init(&output, out, outputFormat);
+		output_begin(&output, "member");
+		output_text(&output, "# ");
+		output_field_str(&output, "archive", filename);
+		output_text(&output, "/");
+		output_field_strn(&output, "member", entry->name, entry->nameLen);
+		output_end(&output);
+		output_free(&output);
+
+		size_t size = 0;
+		const char * ptr = archive_read(archive, i, &size);
+
+		struct PEFile pe;
+		if (ptr == 0 || read_pe_memory(&pe, ptr, size) != 0) {
+			print_failed(out, entry->name, entry->nameLen, "failed");
+			continue;
+		}
+
+		if (dump(&pe, out) != 0) {
+			print_failed(out, entry->name, entry->nameLen, "failed");
+		}
+
+		close_pe_file(&pe);
+	}
+
+	archive_close(archive);
+
+	return 0;
+}
+
+// batch mode, every file is dumped into its own memory buffer by one of
+// the pool workers. buffers are written to stdout in input order by
+// whichever worker completes the next file in line.
+
+struct BatchResult {
+	char * buf;
+	size_t len;
+	int done;
+};
+
+struct Batch {
+	const char ** files;
+	int count;
+
+	struct BatchResult * results;
+
+	pthread_mutex_t lock;
+	int next;
+};
+
+static void batch_work(void * ctx, int index, int)
+{
+	struct Batch * batch = (struct Batch*)ctx;
+	struct BatchResult * result = batch->results + index;
+
+	FILE * out = open_memstream(&result->buf, &result->len);
+	if (out == 0) {
+		result->buf = 0;
+		result->len = 0;
+	} else {
+		if (work(batch->files[index], out) != 0) {
+			print_failed(out, batch->files[index], strlen(batch->files[index]), "failed");
+		}
+		fclose(out);
+	}
+
+	pthread_mutex_lock(&batch->lock);
+	result->done = 1;
+	while (batch->next < batch->count && batch->results[batch->next].done) {
+		struct BatchResult * r = batch->results + batch->next;
+		if (r->buf == 0) {
+			print_failed(stdout, batch->files[batch->next], strlen(batch->files[batch->next]), "out of memory");
+		} else {
+			fwrite(r->buf, 1, r->len, stdout);
+		}
+		free(r->buf);
+		r->buf = 0;
+		batch->next++;
+	}
+	pthread_mutex_unlock(&batch->lock);
+}
+
+static void batch(const char ** files, int count, int threads)
+{
+	struct Batch batch;
+	batch.files = files;
+	batch.count = count;
+	batch.results = (struct BatchResult*)calloc(count > 0 ? count : 1, sizeof(struct BatchResult));
+	batch.next = 0;
+	pthread_mutex_init(&batch.lock, 0);
+
+	pool_run(threads, count, batch_work, &batch);
+
+	fflush(stdout);
+
+	pthread_mutex_destroy(&batch.lock);
+	free(batch.results);
+}
+
+static void add_file(struct FileList * list, const char * name)
+{
+	if (list->count >= list->size) {
+		list->size = list->size ? list->size * 2 : 16;
+		list->names = (const char **)realloc(list->names, sizeof(const char*) * list->size);
+	}
+	list->names[list->count++] = strdup(name);
+}
+
+static void free_file_list(struct FileList * list)
+{
+	for (int i = 0; i < list->count; i++) {
+		free((char*)list->names[i]);
+	}
+	free(list->names);
+}
+
+static int read_file_list(struct FileList * list, const char * listname)
+{
+	FILE * file = fopen(listname, "r");
+	if (file == 0) {
+		return -1;
+	}
+
+	char * line = 0;
+	size_t cap = 0;
+	ssize_t len;
+	while ((len = getline(&line, &cap, file)) >= 0) {
+		while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+			line[--len] = 0;
+		}
+
+		if (len > 0) {
+			add_file(list, line);
+		}
+	}
+
+	free(line);
+	fclose(file);
+
+	return 0;
 }
@@ -1,11 +1,146 @@
+#ifndef _CLRPARSER_OPCODE_H_
+#define _CLRPARSER_OPCODE_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+enum OperandParams {
+	InlineBrTarget = 0, // The operand is a 32-bit integer branch target.
+	InlineField = 1,    // The operand is a 32-bit metadata token.
+	InlineI = 2,        // The operand is a 32-bit integer.
+	InlineI8 = 3,       // The operand is a 64-bit integer.
+	InlineMethod = 4,   // The operand is a 32-bit metadata token.
+	InlineNone = 5,     // No operand.
+	InlinePhi = 6,      // The operand is reserved and should not be used.
+	InlineR = 7,        // The operand is a 64-bit IEEE floating point number.
+	InlineSig = 9,      // The operand is a 32-bit metadata signature token.
+	InlineString = 10,  // The operand is a 32-bit metadata string token.
+	InlineSwitch = 11,  // The operand is the 32-bit integer argument to a switch instruction.
+	InlineTok = 12,     // The operand is a FieldRef, MethodRef, or TypeRef token.
+	InlineType = 13,    // The operand is a 32-bit metadata token.
+	InlineVar = 14,     // The operand is 16-bit integer containing the ordinal of a local variable or an argument.
+	ShortInlineBrTarget = 15, // The operand is an 8-bit integer branch target.
+	ShortInlineI = 16,        // The operand is an 8-bit integer.
+	ShortInlineR = 17,        // The operand is a 32-bit IEEE floating point number.
+	ShortInlineVar = 18,      // The operand is an 8-bit integer containing the ordinal of a local variable or an argumenta.
+};
+
+// control flow column of opcode.def
+enum OpCodeFlow {
+	FLOW_NEXT = 0,
+	FLOW_BRANCH = 1,
+	FLOW_COND_BRANCH = 2,
+	FLOW_CALL = 3,
+	FLOW_RETURN = 4,
+	FLOW_THROW = 5,
+	FLOW_BREAK = 6,
+	FLOW_META = 7,
+};
+
+// stack behaviour column of opcode.def: how many slots an instruction
+// pops or pushes, up to three, and what kind each one is, the deepest
+// slot first. VarPop and VarPush depend on the operand (calls, ret).
+enum StackSlot {
+	SLOT_1 = 1,     // any type
+	SLOT_I = 2,     // int32 or native int
+	SLOT_I8 = 3,
+	SLOT_R4 = 4,
+	SLOT_R8 = 5,
+	SLOT_REF = 6,   // object reference or pointer
+};
+
+#define OPCODE_SLOTS(n, a, b, c) ((n) | (a) << 2 | (b) << 5 | (c) << 8)
+#define OPCODE_VAR_SLOTS 0x800
+
+enum StackBehaviour {
+	Pop0 = OPCODE_SLOTS(0, 0, 0, 0),
+	Pop1 = OPCODE_SLOTS(1, SLOT_1, 0, 0),
+	PopI = OPCODE_SLOTS(1, SLOT_I, 0, 0),
+	PopI8 = OPCODE_SLOTS(1, SLOT_I8, 0, 0),
+	PopR4 = OPCODE_SLOTS(1, SLOT_R4, 0, 0),
+	PopR8 = OPCODE_SLOTS(1, SLOT_R8, 0, 0),
+	PopRef = OPCODE_SLOTS(1, SLOT_REF, 0, 0),
+	Pop1_Pop1 = OPCODE_SLOTS(2, SLOT_1, SLOT_1, 0),
+	PopI_Pop1 = OPCODE_SLOTS(2, SLOT_I, SLOT_1, 0),
+	PopI_PopI = OPCODE_SLOTS(2, SLOT_I, SLOT_I, 0),
+	PopI_PopI8 = OPCODE_SLOTS(2, SLOT_I, SLOT_I8, 0),
+	PopI_PopR4 = OPCODE_SLOTS(2, SLOT_I, SLOT_R4, 0),
+	PopI_PopR8 = OPCODE_SLOTS(2, SLOT_I, SLOT_R8, 0),
+	PopRef_Pop1 = OPCODE_SLOTS(2, SLOT_REF, SLOT_1, 0),
+	PopRef_PopI = OPCODE_SLOTS(2, SLOT_REF, SLOT_I, 0),
+	PopI_PopI_PopI = OPCODE_SLOTS(3, SLOT_I, SLOT_I, SLOT_I),
+	PopRef_PopI_Pop1 = OPCODE_SLOTS(3, SLOT_REF, SLOT_I, SLOT_1),
+	PopRef_PopI_PopI = OPCODE_SLOTS(3, SLOT_REF, SLOT_I, SLOT_I),
+	PopRef_PopI_PopI8 = OPCODE_SLOTS(3, SLOT_REF, SLOT_I, SLOT_I8),
+	PopRef_PopI_PopR4 = OPCODE_SLOTS(3, SLOT_REF, SLOT_I, SLOT_R4),
+	PopRef_PopI_PopR8 = OPCODE_SLOTS(3, SLOT_REF, SLOT_I, SLOT_R8),
+	PopRef_PopI_PopRef = OPCODE_SLOTS(3, SLOT_REF, SLOT_I, SLOT_REF),
+	VarPop = OPCODE_VAR_SLOTS,
+
+	Push0 = OPCODE_SLOTS(0, 0, 0, 0),
+	Push1 = OPCODE_SLOTS(1, SLOT_1, 0, 0),
+	Push1_Push1 = OPCODE_SLOTS(2, SLOT_1, SLOT_1, 0),
+	PushI = OPCODE_SLOTS(1, SLOT_I, 0, 0),
+	PushI8 = OPCODE_SLOTS(1, SLOT_I8, 0, 0),
+	PushR4 = OPCODE_SLOTS(1, SLOT_R4, 0, 0),
+	PushR8 = OPCODE_SLOTS(1, SLOT_R8, 0, 0),
+	PushRef = OPCODE_SLOTS(1, SLOT_REF, 0, 0),
+	VarPush = OPCODE_VAR_SLOTS,
+};
+
+static inline int stack_count(uint16_t behaviour)
+{
+	return behaviour & 0x3;
+}
+
+static inline int stack_slot(uint16_t behaviour, int i)
+{
+	return (behaviour >> (2 + 3 * i)) & 0x7;
+}
+
+// opCodes index of every instruction, CEE_NOP and so on
+enum OpCodeIndex {
+#define OPDEF(A, NAME, POP, PUSH, OPRAND, KIND, LENGTH, B1, B2, CONTROL) A,
+#include "opcode.def"
+	CEE_COUNT
+};
 
 struct OpCode {
 	const char * name;
 	unsigned char code[2];
 	int oprand;
+	uint16_t pop;       // StackBehaviour
+	uint16_t push;
 };
 
 extern struct OpCode opCodes [];
- 
 
-const char * dump_opcode(const char * ptr);
+// decode tables built from opcode.def at compile time, one entry per
+// value of the opcode byte: single byte opcodes and those after 0xFE
+struct OpCodeInfo {
+	int16_t index;      // into opCodes, -1 if the byte is no opcode
+	uint8_t operand;    // OperandParams
+	uint8_t size;       // operand bytes; for InlineSwitch the target count only
+	uint8_t flow;       // OpCodeFlow
+};
+
+struct OpCodeTables {
+	struct OpCodeInfo oneByte[256];
+	struct OpCodeInfo twoByte[256];
+};
+
+extern const struct OpCodeTables opCodeTables;
+
+// the instruction at ptr and the length of its opcode, 0 if it is none
+static inline const struct OpCodeInfo * opcode_info(const char * ptr, int * length)
+{
+	const unsigned char * p = (const unsigned char *)ptr;
+	int prefixed = (p[0] == 0xFE);
+
+	const struct OpCodeInfo * info = prefixed ? opCodeTables.twoByte + p[1] : opCodeTables.oneByte + p[0];
+	*length = 1 + prefixed;
+
+	return info->index >= 0 ? info : 0;
+}
+
+#endif
@@ -0,0 +1,374 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#include <charconv>
+
+#include "output.h"
+
+static const char hexDigits[2][17] = { "0123456789ABCDEF", "0123456789abcdef" };
+
+// the two digits of every byte value
+static const char hexPairs[513] =
+    "000102030405060708090A0B0C0D0E0F101112131415161718191A1B1C1D1E1F"
+    "202122232425262728292A2B2C2D2E2F303132333435363738393A3B3C3D3E3F"
+    "404142434445464748494A4B4C4D4E4F505152535455565758595A5B5C5D5E5F"
+    "606162636465666768696A6B6C6D6E6F707172737475767778797A7B7C7D7E7F"
+    "808182838485868788898A8B8C8D8E8F909192939495969798999A9B9C9D9E9F"
+    "A0A1A2A3A4A5A6A7A8A9AAABACADAEAFB0B1B2B3B4B5B6B7B8B9BABBBCBDBEBF"
+    "C0C1C2C3C4C5C6C7C8C9CACBCCCDCECFD0D1D2D3D4D5D6D7D8D9DADBDCDDDEDF"
+    "E0E1E2E3E4E5E6E7E8E9EAEBECEDEEEFF0F1F2F3F4F5F6F7F8F9FAFBFCFDFEFF";
+
+void output_init(struct Output * out, FILE * file, int format)
+{
+    out->file = file;
+    out->format = format;
+    out->failed = 0;
+    out->items = 0;
+    out->len = 0;
+    // unbuffered if this fails
+    out->buf = (char*)malloc(OUTPUT_BUFFER_SIZE);
+    out->cap = out->buf ? OUTPUT_BUFFER_SIZE : 0;
+}
+
+void output_free(struct Output * out)
+{
+    output_flush(out);
+    free(out->buf);
+    out->buf = 0;
+    out->len = 0;
+    out->cap = 0;
+}
+
+void output_flush(struct Output * out)
+{
+    if (out->file != 0 && out->len > 0) {
+        fwrite(out->buf, 1, out->len, out->file);
+        out->len = 0;
+    }
+}
+
+char * output_take(struct Output * out, size_t * len)
+{
+    char * buf = out->buf;
+    *len = out->len;
+    if (out->failed) {
+        free(buf);
+        buf = 0;
+        *len = 0;
+    }
+
+    out->failed = 0;
+    out->buf = 0;
+    out->len = 0;
+    out->cap = 0;
+    return buf;
+}
+
+static int output_grow(struct Output * out, size_t need)
+{
+    size_t cap = out->cap ? out->cap : OUTPUT_BUFFER_SIZE;
+    while (cap - out->len < need) {
+        cap *= 2;
+    }
+
+    char * buf = (char*)realloc(out->buf, cap);
+    if (buf == 0) {
+        out->failed = 1;
+        return -1;
+    }
+    out->buf = buf;
+    out->cap = cap;
+    return 0;
+}
+
+void output_write(struct Output * out, const char * ptr, size_t len)
+{
+    if (out->failed) {
+        return;
+    }
+
+    if (len > out->cap - out->len) {
+        if (out->file == 0) {
+            if (output_grow(out, len) != 0) {
+                return;
+            }
+        } else {
+            output_flush(out);
+            if (len >= out->cap) {
+                // would not fit anyway, no point in copying
+                fwrite(ptr, 1, len, out->file);
+                return;
+            }
+        }
+    }
+
+    memcpy(out->buf + out->len, ptr, len);
+    out->len += len;
+}
+
+void output_u64(struct Output * out, uint64_t value)
+{
+    char tmp[24];
+    std::to_chars_result r = std::to_chars(tmp, tmp + sizeof(tmp), value);
+    output_write(out, tmp, r.ptr - tmp);
+}
+
+void output_i64(struct Output * out, int64_t value)
+{
+    char tmp[24];
+    std::to_chars_result r = std::to_chars(tmp, tmp + sizeof(tmp), value);
+    output_write(out, tmp, r.ptr - tmp);
+}
+
+void output_hex(struct Output * out, uint64_t value, int width, int letters)
+{
+    assert(letters == OUTPUT_UPPER || letters == OUTPUT_LOWER);
+
+    int n = 1;
+    while (n < 16 && (value >> (4 * n)) != 0) {
+        n++;
+    }
+    if (width > 16) {
+        width = 16;
+    }
+    if (n < width) {
+        n = width;
+    }
+
+    char tmp[16];
+    for (int i = n - 1; i >= 0; i--) {
+        tmp[i] = hexDigits[letters][value & 0xF];
+        value >>= 4;
+    }
+    output_write(out, tmp, n);
+}
+
+void output_double(struct Output * out, double value)
+{
+    // the longest is DBL_MAX, 309 digits before the point
+    char tmp[400];
+    std::to_chars_result r = std::to_chars(tmp, tmp + sizeof(tmp), value, std::chars_format::fixed, 6);
+    assert(r.ec == std::errc());
+    output_write(out, tmp, r.ptr - tmp);
+}
+
+void output_hex_bytes(struct Output * out, const char * ptr, size_t len, char sep)
+{
+    char tmp[256 * 3];
+    size_t n = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        if (n + 3 > sizeof(tmp)) {
+            output_write(out, tmp, n);
+            n = 0;
+        }
+        if (i != 0 && sep != 0) {
+            tmp[n++] = sep;
+        }
+        const char * pair = hexPairs + 2 * (unsigned char)ptr[i];
+        tmp[n++] = pair[0];
+        tmp[n++] = pair[1];
+    }
+
+    output_write(out, tmp, n);
+}
+
+// a JSON string, the bytes past 0x7F pass through as UTF-8
+static void json_string(struct Output * out, const char * ptr, size_t len)
+{
+    output_char(out, '"');
+
+    size_t from = 0;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = ptr[i];
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+
+        output_write(out, ptr + from, i - from);
+        from = i + 1;
+
+        output_char(out, '\\');
+        switch (c) {
+            case '"':  output_char(out, '"'); break;
+            case '\\': output_char(out, '\\'); break;
+            case '\n': output_char(out, 'n'); break;
+            case '\r': output_char(out, 'r'); break;
+            case '\t': output_char(out, 't'); break;
+            default:
+                output_str(out, "u00");
+                output_hex(out, c, 2, OUTPUT_LOWER);
+                break;
+        }
+    }
+    output_write(out, ptr + from, len - from);
+
+    output_char(out, '"');
+}
+
+static void json_key(struct Output * out, const char * name)
+{
+    output_str(out, ",\"");
+    output_str(out, name);
+    output_str(out, "\":");
+}
+
+void output_begin(struct Output * out, const char * record)
+{
+    if (out->format == OUTPUT_JSON) {
+        output_str(out, "{\"record\":\"");
+        output_str(out, record);
+        output_char(out, '"');
+    }
+}
+
+void output_end(struct Output * out)
+{
+    if (out->format == OUTPUT_JSON) {
+        output_char(out, '}');
+    }
+    output_char(out, '\n');
+}
+
+void output_field_str(struct Output * out, const char * name, const char * value)
+{
+    output_field_strn(out, name, value, strlen(value));
+}
+
+void output_field_strn(struct Output * out, const char * name, const char * value, size_t len)
+{
+    if (out->format == OUTPUT_JSON) {
+        json_key(out, name);
+        json_string(out, value, len);
+    } else {
+        output_write(out, value, len);
+    }
+}
+
+void output_field_line(struct Output * out, const char * name, const char * value, size_t len)
+{
+    if (out->format == OUTPUT_JSON) {
+        output_field_strn(out, name, value, len);
+        return;
+    }
+
+    size_t from = 0;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = value[i];
+        if (c >= 0x20 && c != 0x7F && c != '\\') {
+            continue;
+        }
+
+        output_write(out, value + from, i - from);
+        from = i + 1;
+
+        output_char(out, '\\');
+        switch (c) {
+            case '\\': output_char(out, '\\'); break;
+            case '\n': output_char(out, 'n'); break;
+            case '\r': output_char(out, 'r'); break;
+            case '\t': output_char(out, 't'); break;
+            default:
+                output_char(out, 'x');
+                output_hex(out, c, 2, OUTPUT_UPPER);
+                break;
+        }
+    }
+    output_write(out, value + from, len - from);
+}
+
+void output_field_u64(struct Output * out, const char * name, uint64_t value)
+{
+    if (out->format == OUTPUT_JSON) {
+        json_key(out, name);
+    }
+    output_u64(out, value);
+}
+
+void output_field_i64(struct Output * out, const char * name, int64_t value)
+{
+    if (out->format == OUTPUT_JSON) {
+        json_key(out, name);
+    }
+    output_i64(out, value);
+}
+
+void output_field_hex(struct Output * out, const char * name, uint64_t value, int width, int letters)
+{
+    if (out->format == OUTPUT_JSON) {
+        json_key(out, name);
+        output_u64(out, value);
+    } else {
+        output_hex(out, value, width, letters);
+    }
+}
+
+void output_field_double(struct Output * out, const char * name, double value)
+{
+    if (out->format == OUTPUT_JSON) {
+        json_key(out, name);
+        // JSON has no nan or inf
+        if (!isfinite(value)) {
+            output_str(out, "null");
+            return;
+        }
+    }
+    output_double(out, value);
+}
+
+void output_field_bytes(struct Output * out, const char * name, const char * ptr, size_t len, char sep)
+{
+    if (out->format == OUTPUT_JSON) {
+        json_key(out, name);
+        output_char(out, '"');
+        output_hex_bytes(out, ptr, len, sep);
+        output_char(out, '"');
+    } else {
+        output_hex_bytes(out, ptr, len, sep);
+    }
+}
+
+void output_meta_str(struct Output * out, const char * name, const char * value)
+{
+    if (out->format == OUTPUT_JSON) {
+        json_key(out, name);
+        json_string(out, value, strlen(value));
+    }
+}
+
+void output_meta_u64(struct Output * out, const char * name, uint64_t value)
+{
+    if (out->format == OUTPUT_JSON) {
+        json_key(out, name);
+        output_u64(out, value);
+    }
+}
+
+void output_array_begin(struct Output * out, const char * name)
+{
+    out->items = 0;
+    if (out->format == OUTPUT_JSON) {
+        json_key(out, name);
+        output_char(out, '[');
+    }
+}
+
+void output_array_end(struct Output * out)
+{
+    if (out->format == OUTPUT_JSON) {
+        output_char(out, ']');
+    }
+}
+
+void output_item_i64(struct Output * out, int64_t value)
+{
+    if (out->format == OUTPUT_JSON && out->items > 0) {
+        output_char(out, ',');
+    }
+    out->items++;
+    output_i64(out, value);
+}
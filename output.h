@@ -0,0 +1,115 @@
+#ifndef _CLRPARSER_OUTPUT_H_
+#define _CLRPARSER_OUTPUT_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+// buffered writer the dumpers format into. appends go to a large buffer
+// that is written to file when it fills up, or, without a file, grows in
+// memory until output_take hands it over.
+//
+// dumpers emit records, one per line: output_begin, fields and text,
+// output_end. in OUTPUT_TEXT a field prints as its bare value and text
+// prints as is, giving the classic layout; in OUTPUT_JSON every record is
+// one JSON object {"record":kind, name:value...} and text is dropped.
+
+#define OUTPUT_TEXT 0
+#define OUTPUT_JSON 1
+
+#define OUTPUT_BUFFER_SIZE (64 * 1024)
+
+// letter case of hex digits
+#define OUTPUT_UPPER 0
+#define OUTPUT_LOWER 1
+
+struct Output {
+    FILE * file;    // 0 to keep everything in memory
+    int format;     // OUTPUT_TEXT or OUTPUT_JSON
+    int failed;     // memory output ran out, the rest was dropped
+    uint32_t items; // array elements so far
+    char * buf;
+    size_t len;
+    size_t cap;
+};
+
+void output_init(struct Output * out, FILE * file, int format);
+
+// flushes to the file, then releases the buffer
+void output_free(struct Output * out);
+
+void output_flush(struct Output * out);
+
+// the memory output so far, malloc'ed and now owned by the caller; the
+// output starts over empty. 0 if it failed.
+char * output_take(struct Output * out, size_t * len);
+
+// raw appends, no matter the format
+void output_write(struct Output * out, const char * ptr, size_t len);
+
+static inline void output_char(struct Output * out, char c)
+{
+    if (out->len < out->cap) {
+        out->buf[out->len++] = c;
+    } else {
+        output_write(out, &c, 1);
+    }
+}
+
+static inline void output_str(struct Output * out, const char * s)
+{
+    output_write(out, s, strlen(s));
+}
+
+void output_u64(struct Output * out, uint64_t value);
+void output_i64(struct Output * out, int64_t value);
+// at least width digits, zero padded
+void output_hex(struct Output * out, uint64_t value, int width, int letters);
+// fixed with 6 decimals, as %f
+void output_double(struct Output * out, double value);
+// two hex digits a byte, sep between bytes unless 0
+void output_hex_bytes(struct Output * out, const char * ptr, size_t len, char sep);
+
+// records
+
+void output_begin(struct Output * out, const char * record);
+void output_end(struct Output * out);
+
+// layout only, dropped by JSON
+static inline void output_text(struct Output * out, const char * s)
+{
+    if (out->format == OUTPUT_TEXT) {
+        output_str(out, s);
+    }
+}
+
+static inline void output_text_u64(struct Output * out, uint64_t value)
+{
+    if (out->format == OUTPUT_TEXT) {
+        output_u64(out, value);
+    }
+}
+
+void output_field_str(struct Output * out, const char * name, const char * value);
+void output_field_strn(struct Output * out, const char * name, const char * value, size_t len);
+// value kept on one line: text escapes \\ \n \r \t and other control
+// characters as \xHH
+void output_field_line(struct Output * out, const char * name, const char * value, size_t len);
+void output_field_u64(struct Output * out, const char * name, uint64_t value);
+void output_field_i64(struct Output * out, const char * name, int64_t value);
+// hex in text, a number in JSON
+void output_field_hex(struct Output * out, const char * name, uint64_t value, int width, int letters);
+void output_field_double(struct Output * out, const char * name, double value);
+// hex string in both formats
+void output_field_bytes(struct Output * out, const char * name, const char * ptr, size_t len, char sep);
+
+// JSON only fields, for what the text layout leaves out
+void output_meta_str(struct Output * out, const char * name, const char * value);
+void output_meta_u64(struct Output * out, const char * name, uint64_t value);
+
+// a field holding a list; in text only the items print
+void output_array_begin(struct Output * out, const char * name);
+void output_array_end(struct Output * out);
+void output_item_i64(struct Output * out, int64_t value);
+
+#endif
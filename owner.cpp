@@ -0,0 +1,214 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "owner.h"
+#include "lookup.h"
+#include "columnar.h"
+
+#define OWNER_BLOCK_SHIFT 6
+
+struct OwnerList {
+    int member;      // MethodDef, Field ...
+    int list;        // table holding the list column
+    int column;      // the list column
+    int parent;      // TypeDef column of a map table, -1 if list is the owner
+};
+
+static const struct OwnerList owner_lists [] = {
+    { MethodDef, TypeDef,     TypeDefColumns::c_MethodList,       -1 },
+    { Field,     TypeDef,     TypeDefColumns::c_FieldList,        -1 },
+    { Param,     MethodDef,   MethodDefColumns::c_ParamList,      -1 },
+    { Property,  PropertyMap, PropertyMapColumns::c_PropertyList, PropertyMapColumns::c_Parent },
+    { Event,     EventMap,    EventMapColumns::c_EventList,       EventMapColumns::c_Parent },
+};
+
+#define OWNER_LIST_COUNT (sizeof(owner_lists) / sizeof(owner_lists[0]))
+
+struct OwnerRuns {
+    uint32_t ownerCount;
+    uint32_t memberCount;
+    uint32_t * starts;   // first member of every list row, plus memberCount + 1 at the end
+    uint32_t * parents;  // TypeDef of every map row, 0 when the list rows are the owners
+    uint32_t * blocks;   // 1 based list row owning member (b << OWNER_BLOCK_SHIFT) + 1, 0 for none
+};
+
+struct OwnerIndex {
+    struct OwnerRuns * runs[OWNER_LIST_COUNT];
+};
+
+static int find_owner_list(int table)
+{
+    for (int i = 0; i < (int)OWNER_LIST_COUNT; i++) {
+        if (owner_lists[i].member == table) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static struct OwnerRuns * build_runs(struct Context * context, const struct OwnerList * list)
+{
+    const struct Table * table = context->tables + list->list;
+
+    struct OwnerRuns * runs = (struct OwnerRuns*)calloc(1, sizeof(struct OwnerRuns));
+
+    uint32_t n = table->ptr ? table->rowCount : 0;
+    uint32_t members = context->tables[list->member].rowCount;
+
+    runs->ownerCount = n;
+    runs->memberCount = members;
+    runs->starts = (uint32_t*)malloc(sizeof(uint32_t) * (n + 1));
+
+    table_decode_column(table, list->column, 0, n, runs->starts);
+
+    // lists are ascending by the spec; clamp anything else so every run
+    // stays inside the member table and runs never overlap
+    uint32_t last = 1;
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t v = runs->starts[i];
+        if (v < last) v = last;
+        if (v > members + 1) v = members + 1;
+        runs->starts[i] = last = v;
+    }
+    runs->starts[n] = members + 1;
+
+    if (list->parent >= 0 && n > 0) {
+        runs->parents = (uint32_t*)malloc(sizeof(uint32_t) * n);
+        table_decode_column(table, list->parent, 0, n, runs->parents);
+    }
+
+    uint32_t blockCount = (members + (1 << OWNER_BLOCK_SHIFT) - 1) >> OWNER_BLOCK_SHIFT;
+    runs->blocks = (uint32_t*)malloc(sizeof(uint32_t) * (blockCount ? blockCount : 1));
+
+    // owner of member m is the last list row starting at or before m
+    uint32_t k = 0;
+    for (uint32_t b = 0; b < blockCount; b++) {
+        uint32_t m = (b << OWNER_BLOCK_SHIFT) + 1;
+        while (k < n && runs->starts[k] <= m) {
+            k++;
+        }
+        runs->blocks[b] = k;
+    }
+
+    return runs;
+}
+
+static void free_runs(struct OwnerRuns * runs)
+{
+    if (runs) {
+        free(runs->starts);
+        free(runs->parents);
+        free(runs->blocks);
+        free(runs);
+    }
+}
+
+// concurrent first users may both build, the loser frees its copy
+static struct OwnerRuns * get_runs(struct Context * context, int i)
+{
+    struct OwnerIndex * index = __atomic_load_n(&context->owners, __ATOMIC_ACQUIRE);
+    if (index == 0) {
+        struct OwnerIndex * fresh = (struct OwnerIndex*)calloc(1, sizeof(struct OwnerIndex));
+        if (__atomic_compare_exchange_n(&context->owners, &index, fresh, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            index = fresh;
+        } else {
+            free(fresh);
+        }
+    }
+
+    struct OwnerRuns * runs = __atomic_load_n(&index->runs[i], __ATOMIC_ACQUIRE);
+    if (runs == 0) {
+        struct OwnerRuns * fresh = build_runs(context, owner_lists + i);
+        if (__atomic_compare_exchange_n(&index->runs[i], &runs, fresh, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            runs = fresh;
+        } else {
+            free_runs(fresh);
+        }
+    }
+
+    return runs;
+}
+
+uint32_t clr_member_owner(struct Context * context, int table, uint32_t row)
+{
+    int i = find_owner_list(table);
+    if (i < 0) {
+        return 0;
+    }
+
+    const struct OwnerRuns * runs = get_runs(context, i);
+    if (row == 0 || row > runs->memberCount) {
+        return 0;
+    }
+
+    // the owner lies between the owners of this block's first member and
+    // the next block's; empty runs can put many list rows in between, so
+    // search for the last start at or before row rather than stepping
+    uint32_t b = (row - 1) >> OWNER_BLOCK_SHIFT;
+    uint32_t lo = runs->blocks[b];
+    uint32_t hi = (((b + 1) << OWNER_BLOCK_SHIFT) < runs->memberCount) ? runs->blocks[b + 1] : runs->ownerCount;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (runs->starts[mid] <= row) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    uint32_t k = lo;
+
+    if (k == 0) {
+        return 0;
+    }
+
+    return runs->parents ? runs->parents[k - 1] : k;
+}
+
+int clr_member_range(struct Context * context, int table, uint32_t owner, uint32_t * first, uint32_t * count)
+{
+    *first = 0;
+    *count = 0;
+
+    int i = find_owner_list(table);
+    if (i < 0) {
+        return -1;
+    }
+
+    const struct OwnerList * list = owner_lists + i;
+    const struct OwnerRuns * runs = get_runs(context, i);
+
+    uint32_t k = owner;
+    if (runs->parents) {
+        struct RowRange range;
+        if (clr_lookup_owned(context, list->list, list->parent, TypeDef, owner, &range) != 0 || range.count == 0) {
+            return 0;
+        }
+        k = row_range_at(&range, 0);
+    }
+
+    if (k == 0 || k > runs->ownerCount) {
+        return 0;
+    }
+
+    *first = runs->starts[k - 1];
+    *count = runs->starts[k] - runs->starts[k - 1];
+
+    return 0;
+}
+
+void owner_free(struct Context * context)
+{
+    struct OwnerIndex * index = context->owners;
+    if (index == 0) {
+        return;
+    }
+
+    for (int i = 0; i < (int)OWNER_LIST_COUNT; i++) {
+        free_runs(index->runs[i]);
+    }
+
+    free(index);
+    context->owners = 0;
+}
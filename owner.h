@@ -0,0 +1,33 @@
+#ifndef _CLRPARSER_OWNER_H_
+#define _CLRPARSER_OWNER_H_
+
+#include <stdint.h>
+
+#include "clr.h"
+
+// member tables hang off their owner through a list column, the owner's
+// run of members ends where the next owner's starts:
+//
+//   MethodDef, Field   TypeDef.MethodList, TypeDef.FieldList
+//   Param              MethodDef.ParamList
+//   Property, Event    PropertyMap.PropertyList, EventMap.EventList, whose
+//                      Parent is the TypeDef
+//
+// the index keeps the run starts of every owner plus the owner of every
+// 64th member, so a member is resolved by one table lookup and a binary
+// search over the owners that start within its block of 64. each member
+// table's index is built on first use and kept until close_clr. safe to
+// call from several threads.
+
+// 1 based TypeDef row owning a MethodDef, Field, Property or Event row, or
+// MethodDef row owning a Param row; 0 if the row has no owner
+uint32_t clr_member_owner(struct Context * context, int table, uint32_t row);
+
+// members of the given table owned by the TypeDef (or MethodDef for Param)
+// row, as the 1 based rows [first, first + count). returns -1 if table is
+// not a member table.
+int clr_member_range(struct Context * context, int table, uint32_t owner, uint32_t * first, uint32_t * count);
+
+void owner_free(struct Context * context);
+
+#endif
@@ -5,7 +5,15 @@
 #include <stdint.h>
 #include <stdarg.h>
 
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+
 #include "pe.h"
+#include "reader.h"
+#include "clr_header.h"
 
 static char * read_full_file(const char * filename, size_t * size) {
     FILE * file = fopen(filename, "rb");
@@ -39,37 +47,221 @@ static char * read_full_file(const char * filename, size_t * size) {
     return fileMemory;
 }
 
-int read_pe_file(struct PEFile * file, const char * filename)
+static void advise_range(const char * base, size_t size, const char * ptr, size_t len, int advice) {
+	if (ptr < base || ptr >= base + size) {
+		return;
+	}
+
+	if (len > (size_t)(base + size - ptr)) {
+		len = base + size - ptr;
+	}
+
+	uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+	uintptr_t from = (uintptr_t)ptr & ~(page - 1);
+	uintptr_t to = (uintptr_t)ptr + len;
+
+	madvise((void*)from, to - from, advice);
+}
+
+static char * map_full_file(const char * filename, size_t * size) {
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		return 0;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+		close(fd);
+		return 0;
+	}
+
+	void * fileMemory = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (fileMemory == MAP_FAILED) {
+		return 0;
+	}
+
+	// metadata and method bodies are reached through RVAs, so the kernel
+	// read-ahead mostly pulls in resources and native code we never touch.
+	madvise(fileMemory, st.st_size, MADV_RANDOM);
+	advise_range((const char*)fileMemory, st.st_size, (const char*)fileMemory, 4096, MADV_WILLNEED);
+
+	if (size) *size = st.st_size;
+
+	return (char*)fileMemory;
+}
+
+static void release_file_memory(char * ptr, size_t size, int mode) {
+	if (ptr == 0 || mode == PE_LOAD_MEMORY) {
+		return;
+	}
+
+	if (mode == PE_LOAD_MMAP || mode == PE_LOAD_PARTIAL) {
+		munmap(ptr, size);
+	} else {
+		free(ptr);
+	}
+}
+
+// sections are sorted by VirtualAddress once so that an RVA lookup is a
+// binary search, the last hit is tried first because method bodies and
+// metadata are usually all in the same section.
+static int build_section_index(struct PEFile * file)
 {
-    unsigned char ptr[4] = {0x80, 0x0, 0x0, 0x0};
-    assert((*(uint32_t*)ptr) == 128);
+	int count = file->COFFFileHeader->NumberOfSections;
+	if (count == 0) {
+		return 0;
+	}
 
-	size_t fileSize;
-    char * fileMemory = read_full_file(filename, &fileSize);
-    if (fileMemory == 0) {
-        return -1;
-    }
+	if ((const char*)(file->SectionTable + count) > file->ptr + file->size) {
+		fprintf(stderr, " read section table error, NumberOfSections %d\n", count);
+		return -1;
+	}
+
+	struct SectionRange * sections = (struct SectionRange*)malloc(sizeof(struct SectionRange) * count);
+	int n = 0;
+
+	for (int i = 0; i < count; i++) {
+		struct TSectionTable * section = file->SectionTable + i;
+
+		uint64_t size = section->SizeOfRawData;
+		if (section->PointerToRawData >= file->size) {
+			size = 0;
+		} else if (section->PointerToRawData + size > file->size) {
+			size = file->size - section->PointerToRawData;
+		}
+
+		if (size == 0) {
+			continue;
+		}
+
+		struct SectionRange range = { section->VirtualAddress, (uint32_t)size, file->ptr + section->PointerToRawData };
+
+		int j = n++;
+		for (; j > 0 && sections[j - 1].VirtualAddress > range.VirtualAddress; j--) {
+			sections[j] = sections[j - 1];
+		}
+		sections[j] = range;
+	}
+
+	file->sections = sections;
+	file->sectionCount = n;
+	file->lastSection = 0;
+
+	return 0;
+}
+
+static const struct SectionRange * find_section(struct PEFile * file, uint64_t VirtualAddress)
+{
+	const struct SectionRange * sections = file->sections;
+	int count = file->sectionCount;
+	if (count == 0) {
+		return 0;
+	}
+
+	// lastSection is only a hint, threads dumping the same file may race on it
+	int last = __atomic_load_n(&file->lastSection, __ATOMIC_RELAXED);
+	const struct SectionRange * section = sections + last;
+	if (section->VirtualAddress <= VirtualAddress && VirtualAddress - section->VirtualAddress < section->Size) {
+		return section;
+	}
+
+	int lo = 0, hi = count;
+	while (hi - lo > 1) {
+		int mid = (lo + hi) / 2;
+		if (sections[mid].VirtualAddress <= VirtualAddress) {
+			lo = mid;
+		} else {
+			hi = mid;
+		}
+	}
+
+	section = sections + lo;
+	if (section->VirtualAddress <= VirtualAddress && VirtualAddress - section->VirtualAddress < section->Size) {
+		__atomic_store_n(&file->lastSection, lo, __ATOMIC_RELAXED);
+		return section;
+	}
+
+	return 0;
+}
+
+// locate the metadata root through the CLR header, in partial mode this
+// pulls the CLR header in.
+static int find_clr_metadata(struct PEFile * file, uint32_t * rva, uint32_t * size)
+{
+	uint64_t NumberOfRvaAndSizes = 0;
+	if (file->OptionalHeaderWindowsSpecificFields_PE32 != 0) {
+		NumberOfRvaAndSizes = file->OptionalHeaderWindowsSpecificFields_PE32->NumberOfRvaAndSizes;
+	} else if (file->OptionalHeaderWindowsSpecificFields_PE32Plus != 0) {
+		NumberOfRvaAndSizes = file->OptionalHeaderWindowsSpecificFields_PE32Plus->NumberOfRvaAndSizes;
+	}
+
+	if (NumberOfRvaAndSizes < 15 || file->IMAGE_DATA_DIRECTORY[14].VirtualAddress == 0) {
+		return -1;
+	}
+
+	const struct TCLRHeader * CLRHeader = (const struct TCLRHeader*)find_virtual_range(file, file->IMAGE_DATA_DIRECTORY[14].VirtualAddress, sizeof(struct TCLRHeader));
+	if (CLRHeader == 0) {
+		return -1;
+	}
+
+	*rva = CLRHeader->MetaDataVirtualAddress;
+	*size = CLRHeader->MetaDataSize;
+	return 0;
+}
+
+// prefetch the CLR header and the metadata root of a mapped file,
+// everything the table code reads lives in there.
+static void advise_clr_metadata(struct PEFile * file)
+{
+	uint32_t MetaDataVirtualAddress, MetaDataSize;
+	if (find_clr_metadata(file, &MetaDataVirtualAddress, &MetaDataSize) != 0) {
+		return;
+	}
+
+	const char * metadata = find_virtual_range(file, MetaDataVirtualAddress, MetaDataSize);
+	if (metadata != 0) {
+		advise_range(file->ptr, file->size, metadata, MetaDataSize, MADV_WILLNEED);
+	}
+}
 
+// parse the headers of an image that is already in memory, takes ownership of fileMemory
+static int parse_pe_image(struct PEFile * file, char * fileMemory, size_t fileSize, int mode)
+{
     const char * ite = fileMemory;
 
     const char * MSDOSHeader = ite;
     ite += 128;
 
+	if (fileSize < 128) {
+		fprintf(stderr, " read pe file error, file too small %lu\n", fileSize);
+		release_file_memory(fileMemory, fileSize, mode);
+		return -1;
+	}
+
     size_t pe_offset = *(uint32_t*)(MSDOSHeader + 0X3c);
+	if (pe_offset + 4 + sizeof(struct TCOFFFileHeader) > fileSize) {
+		fprintf(stderr, " read pe offset error %lu\n", pe_offset);
+		release_file_memory(fileMemory, fileSize, mode);
+		return -1;
+	}
+
     ite = fileMemory + pe_offset;
 
     const char * PESignature = ite;
     ite += 4;
 
     if (memcmp(PESignature, "PE\0\0", 4) != 0) {
-        printf(" read pe signature error %x, %x, %x, %x\n", PESignature[0], PESignature[1], PESignature[2], PESignature[3]);
-		free(fileMemory);
+        fprintf(stderr, " read pe signature error %x, %x, %x, %x\n", PESignature[0], PESignature[1], PESignature[2], PESignature[3]);
+		release_file_memory(fileMemory, fileSize, mode);
         return -1; 
     }
 
 	memset(file, 0, sizeof(struct PEFile));
 	file->ptr = fileMemory;
 	file->size = fileSize;
+	file->mode = mode;
 
 #define READ_HEADER(TYPE) file->TYPE = (struct T##TYPE*)ite;  ite = (const char *)(file->TYPE + 1);
 
@@ -101,18 +293,263 @@ int read_pe_file(struct PEFile * file, const char * filename)
 
 	file->SectionTable = (struct TSectionTable*)ite;
 
+	if (build_section_index(file) != 0) {
+		release_file_memory(fileMemory, fileSize, mode);
+		memset(file, 0, sizeof(struct PEFile));
+		return -1;
+	}
+
 	return 0;
 }
 
+// partial loading, the file is backed by an anonymous reservation of its
+// full size and pages are pread into it the first time they are asked
+// for. untouched pages are never read and never become resident.
 
-const char * find_virtual_addr(struct PEFile * file, uint64_t VirtualAddress) {
-	for (int i = 0; i < file->COFFFileHeader->NumberOfSections; i++) {
-		struct TSectionTable * section = file->SectionTable + i;
+#define PE_PAGE_SHIFT 12
+#define PE_PAGE_SIZE  (1 << PE_PAGE_SHIFT)
+
+struct PEPartial {
+	struct reader * reader;
+	pthread_mutex_t lock; // serializes preads, the loaded bits are read without it
+};
+
+static int is_page_loaded(const struct PEFile * file, size_t page)
+{
+	uint64_t bits = __atomic_load_n(file->loaded + page / 64, __ATOMIC_ACQUIRE);
+	return (bits & ((uint64_t)1 << (page % 64))) != 0;
+}
+
+// make sure the file bytes [offset, offset + len) are in memory
+static int fetch_file_range(struct PEFile * file, uint64_t offset, size_t len)
+{
+	if (file->mode != PE_LOAD_PARTIAL || len == 0) {
+		return 0;
+	}
 
-		if ( section->VirtualAddress <= VirtualAddress && section->VirtualAddress + section->VirtualSize>= VirtualAddress) {
-			const char * ptr = file->ptr + section->PointerToRawData + (VirtualAddress - section->VirtualAddress);
-			return ptr;
+	if (offset >= file->size) {
+		return -1;
+	}
+
+	if (len > file->size - offset) {
+		len = file->size - offset;
+	}
+
+	size_t first = offset >> PE_PAGE_SHIFT;
+	size_t last = (offset + len - 1) >> PE_PAGE_SHIFT;
+
+	size_t page = first;
+	while (page <= last && is_page_loaded(file, page)) {
+		page++;
+	}
+
+	if (page > last) {
+		return 0;
+	}
+
+	int ret = 0;
+
+	pthread_mutex_lock(&file->partial->lock);
+	while (page <= last) {
+		if (is_page_loaded(file, page)) {
+			page++;
+			continue;
+		}
+
+		// read the whole run of missing pages with one pread
+		size_t end = page + 1;
+		while (end <= last && !is_page_loaded(file, end)) {
+			end++;
+		}
+
+		uint64_t from = (uint64_t)page << PE_PAGE_SHIFT;
+		uint64_t to = (uint64_t)end << PE_PAGE_SHIFT;
+		if (to > file->size) {
+			to = file->size;
+		}
+
+		if (reader_pread(file->partial->reader, file->ptr + from, to - from, from) != to - from) {
+			ret = -1;
+			break;
+		}
+
+		for (size_t i = page; i < end; i++) {
+			__atomic_fetch_or(file->loaded + i / 64, (uint64_t)1 << (i % 64), __ATOMIC_RELEASE);
+		}
+
+		page = end;
+	}
+	pthread_mutex_unlock(&file->partial->lock);
+
+	return ret;
+}
+
+int read_pe_reader(struct PEFile * file, struct reader * reader)
+{
+	uint64_t fileSize = reader_size(reader);
+	if (fileSize < 128) {
+		fprintf(stderr, " read pe file error, file too small %lu\n", fileSize);
+		reader_close(reader);
+		return -1;
+	}
+
+	char * fileMemory = (char*)mmap(0, fileSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (fileMemory == MAP_FAILED) {
+		reader_close(reader);
+		return -1;
+	}
+
+	size_t pages = (fileSize + PE_PAGE_SIZE - 1) >> PE_PAGE_SHIFT;
+
+	struct PEFile partial;
+	memset(&partial, 0, sizeof(struct PEFile));
+	partial.ptr = fileMemory;
+	partial.size = fileSize;
+	partial.mode = PE_LOAD_PARTIAL;
+	partial.loaded = (uint64_t*)calloc((pages + 63) / 64, sizeof(uint64_t));
+	partial.partial = (struct PEPartial*)calloc(1, sizeof(struct PEPartial));
+	partial.partial->reader = reader;
+	pthread_mutex_init(&partial.partial->lock, 0);
+
+	// DOS header, then everything up to the end of the section table
+	int ret = fetch_file_range(&partial, 0, 128);
+	if (ret == 0) {
+		uint64_t pe_offset = *(uint32_t*)(fileMemory + 0x3c);
+		ret = fetch_file_range(&partial, pe_offset, 4 + sizeof(struct TCOFFFileHeader));
+		if (ret == 0 && pe_offset + 4 + sizeof(struct TCOFFFileHeader) <= fileSize) {
+			const struct TCOFFFileHeader * COFFFileHeader = (const struct TCOFFFileHeader*)(fileMemory + pe_offset + 4);
+			uint64_t end = pe_offset + 4 + sizeof(struct TCOFFFileHeader) + COFFFileHeader->SizeOfOptionalHeader
+				+ sizeof(struct TSectionTable) * COFFFileHeader->NumberOfSections;
+			ret = fetch_file_range(&partial, 0, end);
+		}
+	}
+
+	struct PEPartial * state = partial.partial;
+	uint64_t * loaded = partial.loaded;
+
+	if (ret != 0 || parse_pe_image(file, fileMemory, fileSize, PE_LOAD_PARTIAL) != 0) {
+		if (ret != 0) {
+			release_file_memory(fileMemory, fileSize, PE_LOAD_PARTIAL);
 		}
+		pthread_mutex_destroy(&state->lock);
+		reader_close(reader);
+		free(state);
+		free(loaded);
+		return -1;
 	}
+
+	file->loaded = loaded;
+	file->partial = state;
+
+	// the metadata root is needed by read_clr and the table code, method
+	// bodies are pulled in when find_virtual_range asks for them
+	uint32_t MetaDataVirtualAddress, MetaDataSize;
+	if (find_clr_metadata(file, &MetaDataVirtualAddress, &MetaDataSize) == 0) {
+		find_virtual_range(file, MetaDataVirtualAddress, MetaDataSize);
+	}
+
 	return 0;
 }
+
+// the image is used where it is, ptr must stay valid until close_pe_file
+int read_pe_memory(struct PEFile * file, const char * ptr, size_t size)
+{
+	return parse_pe_image(file, (char*)ptr, size, PE_LOAD_MEMORY);
+}
+
+int read_pe_file(struct PEFile * file, const char * filename)
+{
+	return read_pe_file_mode(file, filename, PE_LOAD_MMAP);
+}
+
+int read_pe_file_mode(struct PEFile * file, const char * filename, int mode)
+{
+    unsigned char ptr[4] = {0x80, 0x0, 0x0, 0x0};
+    assert((*(uint32_t*)ptr) == 128);
+
+	if (mode == PE_LOAD_PARTIAL) {
+		struct reader * reader = reader_from_file(filename);
+		if (reader == 0) {
+			return -1;
+		}
+		return read_pe_reader(file, reader);
+	}
+
+	size_t fileSize = 0;
+	char * fileMemory = 0;
+	if (mode == PE_LOAD_MMAP) {
+		fileMemory = map_full_file(filename, &fileSize);
+		if (fileMemory == 0) {
+			// pipes, empty or special files can't be mapped
+			mode = PE_LOAD_READ;
+		}
+	}
+
+	if (mode == PE_LOAD_READ) {
+		fileMemory = read_full_file(filename, &fileSize);
+	}
+
+    if (fileMemory == 0) {
+        return -1;
+    }
+
+	if (parse_pe_image(file, fileMemory, fileSize, mode) != 0) {
+		return -1;
+	}
+
+	if (mode == PE_LOAD_MMAP) {
+		advise_clr_metadata(file);
+	}
+
+	return 0;
+}
+
+void close_pe_file(struct PEFile * file)
+{
+	free(file->sections);
+	release_file_memory(file->ptr, file->size, file->mode);
+
+	if (file->partial != 0) {
+		pthread_mutex_destroy(&file->partial->lock);
+		reader_close(file->partial->reader);
+		free(file->partial);
+	}
+	free(file->loaded);
+
+	memset(file, 0, sizeof(struct PEFile));
+}
+
+const char * find_virtual_addr(struct PEFile * file, uint64_t VirtualAddress) {
+	const struct SectionRange * section = find_section(file, VirtualAddress);
+	if (section == 0) {
+		return 0;
+	}
+
+	// a partial image only holds what was fetched, and without a length
+	// there is no telling how much the caller is about to read
+	if (file->mode == PE_LOAD_PARTIAL) {
+		return 0;
+	}
+
+	return section->ptr + (VirtualAddress - section->VirtualAddress);
+}
+
+// like find_virtual_addr, but the whole [VirtualAddress, VirtualAddress + size) must be backed by the file
+const char * find_virtual_range(struct PEFile * file, uint64_t VirtualAddress, size_t size) {
+	const struct SectionRange * section = find_section(file, VirtualAddress);
+	if (section == 0) {
+		return 0;
+	}
+
+	uint64_t offset = VirtualAddress - section->VirtualAddress;
+	if (size > section->Size - offset) {
+		return 0;
+	}
+
+	const char * ptr = section->ptr + offset;
+	if (file->mode == PE_LOAD_PARTIAL && fetch_file_range(file, ptr - file->ptr, size) != 0) {
+		return 0;
+	}
+
+	return ptr;
+}
@@ -2,6 +2,7 @@
 #define _CLRPARSER_PE_HEADER_H_
 
 #include <stdlib.h>
+#include <stdint.h>
 
 #pragma pack(push, 1)
 struct TCOFFFileHeader {
@@ -167,9 +168,27 @@ struct TSectionTable {
 
 #pragma pack(pop)
 
+enum PELoadMode {
+	PE_LOAD_READ = 0, // malloc + fread the whole file
+	PE_LOAD_MMAP = 1, // read-only private mapping, pages are faulted in on access
+	PE_LOAD_PARTIAL = 2, // only headers and metadata are pread, method bodies on demand
+	PE_LOAD_MEMORY = 3, // parsed in place from memory owned by the caller
+};
+
+struct reader;
+struct PEPartial;
+
+// file backed part of a section, [VirtualAddress, VirtualAddress + Size) maps to ptr
+struct SectionRange {
+	uint32_t VirtualAddress;
+	uint32_t Size;
+	const char * ptr;
+};
+
 struct PEFile {
 	char * ptr;
 	size_t size;
+	int mode;
 
 	struct TCOFFFileHeader * COFFFileHeader;
 
@@ -181,9 +200,24 @@ struct PEFile {
 
 	struct TIMAGE_DATA_DIRECTORY * IMAGE_DATA_DIRECTORY;
 	struct TSectionTable * SectionTable;
+
+	// SectionTable sorted by VirtualAddress, used to translate RVAs
+	struct SectionRange * sections;
+	int sectionCount;
+	int lastSection;
+
+	// PE_LOAD_PARTIAL, one bit per 4k page of ptr that was read already
+	uint64_t * loaded;
+	struct PEPartial * partial;
 };
 
 int read_pe_file(struct PEFile * file, const char * filename);
+int read_pe_file_mode(struct PEFile * file, const char * filename, int mode);
+int read_pe_reader(struct PEFile * file, struct reader * reader);
+int read_pe_memory(struct PEFile * file, const char * ptr, size_t size);
+void close_pe_file(struct PEFile * file);
+// always 0 for PE_LOAD_PARTIAL images, use find_virtual_range there
 const char * find_virtual_addr(struct PEFile * file, uint64_t VirtualAddress);
+const char * find_virtual_range(struct PEFile * file, uint64_t VirtualAddress, size_t size);
 
 #endif
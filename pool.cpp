@@ -0,0 +1,177 @@
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "pool.h"
+
+struct PoolSlice {
+    pthread_mutex_t lock;
+    int begin;
+    int end;
+};
+
+struct Pool {
+    void (*func)(void * ctx, int index, int worker);
+    void * ctx;
+
+    int threads;
+    struct PoolSlice * slices;
+};
+
+struct PoolWorker {
+    struct Pool * pool;
+    int id;
+};
+
+int pool_cpu_count()
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+
+static int pool_take(struct PoolSlice * slice)
+{
+    int index = -1;
+
+    pthread_mutex_lock(&slice->lock);
+    if (slice->begin < slice->end) {
+        index = slice->begin;
+        __atomic_store_n(&slice->begin, index + 1, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&slice->lock);
+
+    return index;
+}
+
+static int pool_steal(struct Pool * pool, int id)
+{
+    struct PoolSlice * own = pool->slices + id;
+
+    for (;;) {
+        // pick the victim with the most work left, sizes are read unlocked
+        // and only used as a hint
+        int victim = -1;
+        int best = 0;
+        for (int i = 1; i < pool->threads; i++) {
+            int v = (id + i) % pool->threads;
+            struct PoolSlice * slice = pool->slices + v;
+            int left = __atomic_load_n(&slice->end, __ATOMIC_RELAXED) - __atomic_load_n(&slice->begin, __ATOMIC_RELAXED);
+            if (left > best) {
+                best = left;
+                victim = v;
+            }
+        }
+
+        if (victim < 0) {
+            return -1;
+        }
+
+        struct PoolSlice * slice = pool->slices + victim;
+
+        int begin = 0, end = 0;
+        pthread_mutex_lock(&slice->lock);
+        if (slice->begin < slice->end) {
+            int mid = slice->end - (slice->end - slice->begin + 1) / 2;
+            begin = mid;
+            end = slice->end;
+            __atomic_store_n(&slice->end, mid, __ATOMIC_RELAXED);
+        }
+        pthread_mutex_unlock(&slice->lock);
+
+        if (begin == end) {
+            continue;
+        }
+
+        pthread_mutex_lock(&own->lock);
+        __atomic_store_n(&own->begin, begin + 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&own->end, end, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&own->lock);
+
+        return begin;
+    }
+}
+
+static void * pool_main(void * arg)
+{
+    struct PoolWorker * worker = (struct PoolWorker*)arg;
+    struct Pool * pool = worker->pool;
+    int id = worker->id;
+
+    for (;;) {
+        int index = pool_take(pool->slices + id);
+        if (index < 0) {
+            index = pool_steal(pool, id);
+        }
+
+        if (index < 0) {
+            break;
+        }
+
+        pool->func(pool->ctx, index, id);
+    }
+
+    return 0;
+}
+
+void pool_run(int threads, int count, void (*func)(void * ctx, int index, int worker), void * ctx)
+{
+    if (threads < 1) {
+        threads = 1;
+    }
+
+    if (threads > count) {
+        threads = count > 0 ? count : 1;
+    }
+
+    if (threads == 1) {
+        for (int i = 0; i < count; i++) {
+            func(ctx, i, 0);
+        }
+        return;
+    }
+
+    struct Pool pool;
+    pool.func = func;
+    pool.ctx = ctx;
+    pool.threads = threads;
+    pool.slices = (struct PoolSlice*)malloc(sizeof(struct PoolSlice) * threads);
+
+    struct PoolWorker * workers = (struct PoolWorker*)malloc(sizeof(struct PoolWorker) * threads);
+    pthread_t * tids = (pthread_t*)malloc(sizeof(pthread_t) * threads);
+
+    for (int i = 0; i < threads; i++) {
+        pthread_mutex_init(&pool.slices[i].lock, 0);
+        pool.slices[i].begin = (int)((int64_t)count * i / threads);
+        pool.slices[i].end   = (int)((int64_t)count * (i + 1) / threads);
+
+        workers[i].pool = &pool;
+        workers[i].id = i;
+    }
+
+    int started = 1;
+    for (int i = 1; i < threads; i++, started++) {
+        if (pthread_create(tids + i, 0, pool_main, workers + i) != 0) {
+            break;
+        }
+    }
+
+    // the calling thread is worker 0, slices of threads that failed to
+    // start are picked up by stealing
+    pool_main(workers);
+
+    for (int i = 1; i < started; i++) {
+        pthread_join(tids[i], 0);
+    }
+
+    for (int i = 0; i < threads; i++) {
+        pthread_mutex_destroy(&pool.slices[i].lock);
+    }
+
+    free(tids);
+    free(workers);
+    free(pool.slices);
+}
@@ -0,0 +1,15 @@
+#ifndef _CLRPARSER_POOL_H_
+#define _CLRPARSER_POOL_H_
+
+// number of online cpus, at least 1
+int pool_cpu_count();
+
+// run func(ctx, index, worker) for every index in [0, count) on `threads` threads.
+//
+// every worker starts with an equal slice of the index range and takes
+// indexes from the front of it; a worker that runs dry steals the back half
+// of the largest remaining slice of another worker. the calling thread
+// works as worker 0 and pool_run returns when every index was processed.
+void pool_run(int threads, int count, void (*func)(void * ctx, int index, int worker), void * ctx);
+
+#endif
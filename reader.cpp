@@ -2,14 +2,18 @@
 #include "reader.h"
 
 #include <assert.h>
+#include <errno.h>
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
 #include <stdint.h>
+#include <sys/stat.h>
 
 struct reader {
     void *ctx;
     size_t (*read)(void *ctx, char * ptr, size_t len);
+    size_t (*pread)(void *ctx, char * ptr, size_t len, uint64_t offset);
+    uint64_t (*size)(void *ctx);
     int (*close)(void *ctx);
 };
 
@@ -18,6 +22,21 @@ size_t reader_read(struct reader * reader, char * ptr, size_t len) {
     return reader->read(reader->ctx, ptr, len);
 }
 
+// positional read, doesn't move the position used by reader_read
+size_t reader_pread(struct reader * reader, char * ptr, size_t len, uint64_t offset) {
+    if (reader->pread == 0) {
+        return 0;
+    }
+    return reader->pread(reader->ctx, ptr, len, offset);
+}
+
+uint64_t reader_size(struct reader * reader) {
+    if (reader->size == 0) {
+        return 0;
+    }
+    return reader->size(reader->ctx);
+}
+
 int reader_close(struct reader * reader) {
     int ret = 0;
     if (reader->close != 0) {
@@ -39,6 +58,31 @@ static size_t file_read(void *ctx, char * ptr, size_t len) {
     return ftell(file) - cur;
 }
 
+static size_t file_pread(void *ctx, char * ptr, size_t len, uint64_t offset) {
+    int fd = fileno((FILE*)ctx);
+
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = pread(fd, ptr + done, len - done, offset + done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        done += n;
+    }
+    return done;
+}
+
+static uint64_t file_size(void *ctx) {
+    struct stat st;
+    if (fstat(fileno((FILE*)ctx), &st) != 0) {
+        return 0;
+    }
+    return st.st_size;
+}
+
 static int file_close(void *ctx) {
     int ret = 0;
     FILE * file = (FILE*)ctx;
@@ -59,6 +103,8 @@ struct reader * reader_from_file(const char * filename) {
 
     reader->ctx = file;
     reader->read = file_read;
+    reader->pread = file_pread;
+    reader->size = file_size;
     reader->close = file_close;
 
     return reader;
@@ -67,6 +113,9 @@ struct reader * reader_from_file(const char * filename) {
 struct memory {
     const char * ptr;
     size_t len;
+
+    const char * base;
+    size_t size;
 };
 
 static size_t mem_read(void *ctx, char * ptr, size_t len) {
@@ -89,6 +138,24 @@ static size_t mem_read(void *ctx, char * ptr, size_t len) {
     return len;
 }
 
+static size_t mem_pread(void *ctx, char * ptr, size_t len, uint64_t offset) {
+    struct memory * mem = (struct memory *)ctx;
+    if (offset >= mem->size) {
+        return 0;
+    }
+
+    if (len > mem->size - offset) {
+        len = mem->size - offset;
+    }
+
+    memcpy(ptr, mem->base + offset, len);
+    return len;
+}
+
+static uint64_t mem_size(void *ctx) {
+    return ((struct memory *)ctx)->size;
+}
+
 static int mem_close(void *ctx) {
     return 0;
 }
@@ -100,9 +167,13 @@ struct reader * reader_from_memory(const char * ptr, size_t len) {
     struct memory * mem = (struct memory*)(reader + 1);
     mem->ptr = ptr;
     mem->len = len;
+    mem->base = ptr;
+    mem->size = len;
 
     reader->ctx = mem;
     reader->read = mem_read;
+    reader->pread = mem_pread;
+    reader->size = mem_size;
     reader->close = mem_close;
 
     return reader;
@@ -10,6 +10,8 @@ struct reader * reader_from_file(const char * filename);
 struct reader * reader_from_memory(const char * ptr, size_t len);
 
 size_t reader_read(struct reader * reader, char * ptr, size_t len);
+size_t reader_pread(struct reader * reader, char * ptr, size_t len, uint64_t offset);
+uint64_t reader_size(struct reader * reader);
 int reader_close(struct reader * reader);
 
 
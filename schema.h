@@ -0,0 +1,155 @@
+#ifndef _CLRPARSER_SCHEMA_H_
+#define _CLRPARSER_SCHEMA_H_
+
+#include <stdint.h>
+
+#include "table.h"
+
+enum TableType {
+    Module                 = 0x00,
+    TypeRef                = 0x01,
+    TypeDef                = 0x02,
+    Field                  = 0x04,
+    MethodDef              = 0x06,
+    Param                  = 0x08,
+    InterfaceImpl          = 0x09,
+    MemberRef              = 0x0A,
+    Constant               = 0x0B,
+    CustomAttribute        = 0x0C,
+    FieldMarshal           = 0x0D,
+    DeclSecurity           = 0x0E,
+    ClassLayout            = 0x0F,
+    FieldLayout            = 0x10,
+    StandAloneSig          = 0x11,
+    EventMap               = 0x12,
+    Event                  = 0x14,
+    PropertyMap            = 0x15,
+    Property               = 0x17,
+    MethodSemantics        = 0x18,
+    MethodImpl             = 0x19,
+    ModuleRef              = 0x1A,
+    TypeSpec               = 0x1B,
+    ImplMap                = 0x1C,
+    FieldRVA               = 0x1D,
+    Assembly               = 0x20,
+    AssemblyOS             = 0x22,
+    AssemblyProcesser      = 0x21,
+    AssemblyRef            = 0x23,
+    AssemblyRefProcessor   = 0x24,
+    AssemblyRefOS          = 0x25,
+    File                   = 0x26,
+    ExportedType           = 0x27,
+    ManifestResource       = 0x28,
+    NestedClass            = 0x29,
+    GenericParam           = 0x2A,
+    MethodSpec             = 0x2B,
+    GenericParamConstraint = 0x2C,
+
+    Permission = 0x38, // TODO:
+    NotUsed = 0x39,
+};
+
+// coded index kinds in schema.def order, CodedIndex_TypeDefOrRef etc.
+#define CODED(KIND, ...) CodedIndex_##KIND,
+enum CodedIndexKind {
+#include "schema.def"
+    CodedIndex_Count
+};
+
+// how the values of an index column decode, worked out once per metadata
+// from the row counts. simple indexes are a single table with no tag bits.
+struct CodedIndex {
+    uint8_t tagBits;
+    uint8_t width;       // 2 or 4 bytes in the table
+    uint8_t tableCount;
+    uint32_t tagMask;
+    uint8_t tables[32];  // table of every tag, NotUsed past tableCount
+};
+
+static inline uint32_t decode_coded_index(const struct CodedIndex * index, uint32_t value, int * table) {
+    *table = index->tables[value & index->tagMask];
+    return value >> index->tagBits;
+}
+
+// the stored value of a reference to row of table, -1 if the index kind
+// cannot refer to that table
+static inline int encode_coded_index(const struct CodedIndex * index, int table, uint32_t row, uint32_t * value) {
+    for (int tag = 0; tag < index->tableCount; tag++) {
+        if (index->tables[tag] == table) {
+            *value = (row << index->tagBits) | tag;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// decode count values at once, tables and rows may alias each other's input
+void decode_coded_indexes(const struct CodedIndex * index, const uint32_t * values, size_t count, uint8_t * tables, uint32_t * rows);
+
+// column numbers of every table, TypeDefColumns::c_MethodList etc.
+#define F(NAME, SIZE) c_##NAME,
+#define S(NAME)       c_##NAME,
+#define G(NAME)       c_##NAME,
+#define B(NAME)       c_##NAME,
+#define T(NAME, TAB)  c_##NAME,
+#define C(NAME, KIND) c_##NAME,
+#define TABLE(TYPE, ...) struct TYPE##Columns { enum { __VA_ARGS__ c_Count }; };
+#include "schema.def"
+#undef F
+#undef S
+#undef G
+#undef B
+#undef T
+#undef C
+
+// a row of a present table. widths and offsets were fixed by table_init,
+// so an accessor is a load at a known column, no lookup by name.
+struct RowBase {
+    const struct Table * table;
+    const char * ptr;
+
+    RowBase(const struct Table * table, int row) : table(table), ptr(table->ptr + table->cellSize * row) {}
+
+    template<int SIZE> uint32_t fixed(int column) const {
+        const char * p = ptr + table->offset[column];
+        return (SIZE == 4) ? *(const uint32_t*)p : *(const uint16_t*)p;
+    }
+
+    uint32_t index(int column) const {
+        const char * p = ptr + table->offset[column];
+        return (table->width[column] == 4) ? *(const uint32_t*)p : *(const uint16_t*)p;
+    }
+
+    uint32_t coded(int column, int * tab) const {
+        return decode_coded_index((const struct CodedIndex*)table->fields[column].ctx, index(column), tab);
+    }
+};
+
+// Row<TypeDef> row(context->tables, i); row.TypeName(), row.MethodList() ...
+// heap columns return the heap offset, T columns the 1 based row (0 is nil)
+// and C columns the raw coded value, or the row with its table given a
+// table out parameter.
+template<int TYPE> struct Row;
+
+#define F(NAME, SIZE) uint32_t NAME() const { return fixed<SIZE>(Columns::c_##NAME); }
+#define S(NAME)       uint32_t NAME() const { return index(Columns::c_##NAME); }
+#define G(NAME)       uint32_t NAME() const { return index(Columns::c_##NAME); }
+#define B(NAME)       uint32_t NAME() const { return index(Columns::c_##NAME); }
+#define T(NAME, TAB)  uint32_t NAME() const { return index(Columns::c_##NAME); }
+#define C(NAME, KIND) uint32_t NAME() const { return index(Columns::c_##NAME); } \
+                      uint32_t NAME(int * tab) const { return coded(Columns::c_##NAME, tab); }
+#define TABLE(TYPE, ...) \
+    template<> struct Row<TYPE> : RowBase { \
+        typedef TYPE##Columns Columns; \
+        Row(const struct Table * tables, int row) : RowBase(tables + ::TYPE, row) {} \
+        __VA_ARGS__ \
+    };
+#include "schema.def"
+#undef F
+#undef S
+#undef G
+#undef B
+#undef T
+#undef C
+
+#endif
@@ -0,0 +1,732 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "signature.h"
+#include "symbol.h"
+#include "arena.h"
+
+#define SIG_MAX_DEPTH 64
+#define SIG_ARENA_CHUNK (64 * 1024)
+
+struct SigEntry {
+    uint64_t key;   // blob << 1 | typespec, plus one so 0 is an empty slot
+    const struct Signature * sig;
+};
+
+// blobs decoded so far. lookups and decoding hold the lock, the arena is
+// not thread safe and decoding a blob is cheap next to contending for it.
+struct SignatureCache {
+    pthread_mutex_t lock;
+    struct Arena arena;
+    struct SigEntry * entries;
+    uint32_t mask;
+    uint32_t used;
+};
+
+// remembered for blobs that do not decode, so they are not tried again
+static const struct Signature malformed = { 0, 0, 0, 0, -1, 0, 0 };
+
+// types without payload or modifiers are shared instead of allocated
+#define SIMPLE(element) { element, 0, 0, 0, 0, 0, 0, 0, 0 }
+
+static const struct SigType simple_types[0x20] = {
+    SIMPLE(0x00), SIMPLE(0x01), SIMPLE(0x02), SIMPLE(0x03),
+    SIMPLE(0x04), SIMPLE(0x05), SIMPLE(0x06), SIMPLE(0x07),
+    SIMPLE(0x08), SIMPLE(0x09), SIMPLE(0x0a), SIMPLE(0x0b),
+    SIMPLE(0x0c), SIMPLE(0x0d), SIMPLE(0x0e), SIMPLE(0x0f),
+    SIMPLE(0x10), SIMPLE(0x11), SIMPLE(0x12), SIMPLE(0x13),
+    SIMPLE(0x14), SIMPLE(0x15), SIMPLE(0x16), SIMPLE(0x17),
+    SIMPLE(0x18), SIMPLE(0x19), SIMPLE(0x1a), SIMPLE(0x1b),
+    SIMPLE(0x1c), SIMPLE(0x1d), SIMPLE(0x1e), SIMPLE(0x1f),
+};
+
+#undef SIMPLE
+
+static inline int is_simple(int element)
+{
+    return (element >= ELEMENT_TYPE_VOID && element <= ELEMENT_TYPE_STRING)
+        || element == ELEMENT_TYPE_TYPEDBYREF || element == ELEMENT_TYPE_I
+        || element == ELEMENT_TYPE_U || element == ELEMENT_TYPE_OBJECT;
+}
+
+struct SigReader {
+    struct Context * context;
+    struct Arena * arena;
+    const char * ptr;
+    const char * end;
+    int depth;
+};
+
+static inline int read_u32(struct SigReader * reader, uint32_t * value)
+{
+    reader->ptr = read_compressed(reader->ptr, reader->end, value);
+    return reader->ptr ? 0 : -1;
+}
+
+// II.23.2 signed form: the value rotated left by one within its width, so
+// the low bit is the sign
+static int read_i32(struct SigReader * reader, int32_t * value)
+{
+    const char * start = reader->ptr;
+    uint32_t raw;
+    if (read_u32(reader, &raw) != 0) {
+        return -1;
+    }
+
+    // 1, 2 and 4 byte forms carry 7, 14 and 29 bits
+    int bits = (reader->ptr - start == 1) ? 7 : (reader->ptr - start == 2) ? 14 : 29;
+
+    *value = (int32_t)(raw >> 1);
+    if (raw & 1) {
+        *value -= (int32_t)1 << (bits - 1);
+    }
+    return 0;
+}
+
+static inline int read_byte(struct SigReader * reader, uint8_t * value)
+{
+    if (reader->ptr >= reader->end) {
+        return -1;
+    }
+    *value = (uint8_t)*reader->ptr++;
+    return 0;
+}
+
+static inline int peek_byte(struct SigReader * reader)
+{
+    return (reader->ptr < reader->end) ? (uint8_t)*reader->ptr : -1;
+}
+
+// TypeDefOrRefOrSpecEncoded as a token
+static int read_token(struct SigReader * reader, uint32_t * token)
+{
+    uint32_t coded;
+    if (read_u32(reader, &coded) != 0) {
+        return -1;
+    }
+
+    int table;
+    uint32_t row = decode_coded_index(reader->context->codedIndex + CodedIndex_TypeDefOrRef, coded, &table);
+    if (row == 0 || table < 0 || row > reader->context->tables[table].rowCount) {
+        return -1;
+    }
+
+    *token = ((uint32_t)table << 24) | row;
+    return 0;
+}
+
+// every element of a list takes at least a byte, which bounds counts
+// read from a malformed blob
+static inline int check_count(struct SigReader * reader, uint32_t count)
+{
+    return count <= (uint32_t)(reader->end - reader->ptr) ? 0 : -1;
+}
+
+static const struct Signature * read_method(struct SigReader * reader, uint8_t callingConvention);
+
+static const struct SigType * read_type(struct SigReader * reader)
+{
+    if (++reader->depth > SIG_MAX_DEPTH) {
+        return 0;
+    }
+
+    // custom modifiers are counted first, then read into place
+    const char * start = reader->ptr;
+    uint32_t modCount = 0;
+    int b;
+    while ((b = peek_byte(reader)) == ELEMENT_TYPE_CMOD_REQD || b == ELEMENT_TYPE_CMOD_OPT) {
+        uint32_t token;
+        reader->ptr++;
+        if (read_token(reader, &token) != 0 || ++modCount > 255) {
+            return 0;
+        }
+    }
+
+    struct SigModifier * mods = 0;
+    if (modCount) {
+        mods = (struct SigModifier*)arena_alloc(reader->arena, sizeof(struct SigModifier) * modCount);
+        reader->ptr = start;
+        for (uint32_t i = 0; i < modCount; i++) {
+            mods[i].required = (uint8_t)*reader->ptr++ == ELEMENT_TYPE_CMOD_REQD;
+            read_token(reader, &mods[i].token);
+        }
+    }
+
+    uint8_t element;
+    if (read_byte(reader, &element) != 0) {
+        return 0;
+    }
+
+    if (is_simple(element) && modCount == 0) {
+        reader->depth--;
+        return simple_types + element;
+    }
+
+    struct SigType * type = (struct SigType*)arena_alloc(reader->arena, sizeof(struct SigType));
+    type->element = element;
+    type->modCount = modCount;
+    type->mods = mods;
+
+    switch(element) {
+        case ELEMENT_TYPE_PTR:
+        case ELEMENT_TYPE_BYREF:
+        case ELEMENT_TYPE_SZARRAY:
+        case ELEMENT_TYPE_PINNED:
+            if ((type->inner = read_type(reader)) == 0) {
+                return 0;
+            }
+            break;
+        case ELEMENT_TYPE_VALUETYPE:
+        case ELEMENT_TYPE_CLASS:
+            if (read_token(reader, &type->token) != 0) {
+                return 0;
+            }
+            break;
+        case ELEMENT_TYPE_VAR:
+        case ELEMENT_TYPE_MVAR:
+            if (read_u32(reader, &type->token) != 0) {
+                return 0;
+            }
+            break;
+        case ELEMENT_TYPE_ARRAY: {
+            if ((type->inner = read_type(reader)) == 0) {
+                return 0;
+            }
+
+            struct SigArrayShape * shape = (struct SigArrayShape*)arena_alloc(reader->arena, sizeof(struct SigArrayShape));
+            if (read_u32(reader, &shape->rank) != 0 || read_u32(reader, &shape->sizeCount) != 0 || check_count(reader, shape->sizeCount) != 0) {
+                return 0;
+            }
+
+            uint32_t * sizes = (uint32_t*)arena_alloc(reader->arena, sizeof(uint32_t) * shape->sizeCount);
+            for (uint32_t i = 0; i < shape->sizeCount; i++) {
+                if (read_u32(reader, sizes + i) != 0) {
+                    return 0;
+                }
+            }
+
+            if (read_u32(reader, &shape->boundCount) != 0 || check_count(reader, shape->boundCount) != 0) {
+                return 0;
+            }
+
+            int32_t * bounds = (int32_t*)arena_alloc(reader->arena, sizeof(int32_t) * shape->boundCount);
+            for (uint32_t i = 0; i < shape->boundCount; i++) {
+                if (read_i32(reader, bounds + i) != 0) {
+                    return 0;
+                }
+            }
+
+            shape->sizes = sizes;
+            shape->lowerBounds = bounds;
+            type->shape = shape;
+            break;
+        }
+        case ELEMENT_TYPE_GENERICINST: {
+            uint8_t kind;
+            if (read_byte(reader, &kind) != 0 || (kind != ELEMENT_TYPE_CLASS && kind != ELEMENT_TYPE_VALUETYPE)) {
+                return 0;
+            }
+
+            struct SigType * generic = (struct SigType*)arena_alloc(reader->arena, sizeof(struct SigType));
+            generic->element = kind;
+            if (read_token(reader, &generic->token) != 0) {
+                return 0;
+            }
+            type->inner = generic;
+
+            if (read_u32(reader, &type->argCount) != 0 || type->argCount == 0 || check_count(reader, type->argCount) != 0) {
+                return 0;
+            }
+
+            const struct SigType ** args = (const struct SigType**)arena_alloc(reader->arena, sizeof(struct SigType*) * type->argCount);
+            for (uint32_t i = 0; i < type->argCount; i++) {
+                if ((args[i] = read_type(reader)) == 0) {
+                    return 0;
+                }
+            }
+            type->args = args;
+            break;
+        }
+        case ELEMENT_TYPE_FNPTR: {
+            uint8_t callingConvention;
+            if (read_byte(reader, &callingConvention) != 0 || (type->method = read_method(reader, callingConvention)) == 0) {
+                return 0;
+            }
+            break;
+        }
+        default:
+            if (!is_simple(element)) {
+                return 0;
+            }
+            break;
+    }
+
+    reader->depth--;
+    return type;
+}
+
+static const struct SigType ** read_types(struct SigReader * reader, uint32_t count)
+{
+    if (check_count(reader, count) != 0) {
+        return 0;
+    }
+
+    const struct SigType ** types = (const struct SigType**)arena_alloc(reader->arena, sizeof(struct SigType*) * (count ? count : 1));
+    for (uint32_t i = 0; i < count; i++) {
+        if ((types[i] = read_type(reader)) == 0) {
+            return 0;
+        }
+    }
+    return types;
+}
+
+// method and property signatures, after the calling convention byte
+static const struct Signature * read_method(struct SigReader * reader, uint8_t callingConvention)
+{
+    struct Signature * sig = (struct Signature*)arena_alloc(reader->arena, sizeof(struct Signature));
+    sig->kind = ((callingConvention & SIG_KIND_MASK) == SIG_PROPERTY) ? Sig_Property : Sig_Method;
+    sig->callingConvention = callingConvention;
+    sig->sentinel = -1;
+
+    if ((callingConvention & SIG_GENERIC) && read_u32(reader, &sig->genericCount) != 0) {
+        return 0;
+    }
+
+    if (read_u32(reader, &sig->count) != 0 || check_count(reader, sig->count) != 0 || (sig->type = read_type(reader)) == 0) {
+        return 0;
+    }
+
+    const struct SigType ** params = (const struct SigType**)arena_alloc(reader->arena, sizeof(struct SigType*) * (sig->count ? sig->count : 1));
+    for (uint32_t i = 0; i < sig->count; i++) {
+        if (peek_byte(reader) == ELEMENT_TYPE_SENTINEL && sig->sentinel < 0) {
+            reader->ptr++;
+            sig->sentinel = i;
+        }
+        if ((params[i] = read_type(reader)) == 0) {
+            return 0;
+        }
+    }
+    sig->types = params;
+
+    return sig;
+}
+
+static const struct Signature * decode(struct SigReader * reader, int typeSpec)
+{
+    if (typeSpec) {
+        struct Signature * sig = (struct Signature*)arena_alloc(reader->arena, sizeof(struct Signature));
+        sig->kind = Sig_TypeSpec;
+        sig->sentinel = -1;
+        return (sig->type = read_type(reader)) ? sig : 0;
+    }
+
+    uint8_t callingConvention;
+    if (read_byte(reader, &callingConvention) != 0) {
+        return 0;
+    }
+
+    switch(callingConvention & SIG_KIND_MASK) {
+        case SIG_FIELD: {
+            struct Signature * sig = (struct Signature*)arena_alloc(reader->arena, sizeof(struct Signature));
+            sig->kind = Sig_Field;
+            sig->callingConvention = callingConvention;
+            sig->sentinel = -1;
+            return (sig->type = read_type(reader)) ? sig : 0;
+        }
+        case SIG_LOCAL_SIG:
+        case SIG_GENERICINST: {
+            struct Signature * sig = (struct Signature*)arena_alloc(reader->arena, sizeof(struct Signature));
+            sig->kind = ((callingConvention & SIG_KIND_MASK) == SIG_LOCAL_SIG) ? Sig_Locals : Sig_MethodSpec;
+            sig->callingConvention = callingConvention;
+            sig->sentinel = -1;
+            if (read_u32(reader, &sig->count) != 0 || (sig->types = read_types(reader, sig->count)) == 0) {
+                return 0;
+            }
+            return sig;
+        }
+        case SIG_DEFAULT:
+        case SIG_C:
+        case SIG_STDCALL:
+        case SIG_THISCALL:
+        case SIG_FASTCALL:
+        case SIG_VARARG:
+        case SIG_PROPERTY:
+            return read_method(reader, callingConvention);
+        default:
+            return 0;
+    }
+}
+
+static struct SignatureCache * get_cache(struct Context * context)
+{
+    struct SignatureCache * cache = __atomic_load_n(&context->signatures, __ATOMIC_ACQUIRE);
+    if (cache == 0) {
+        struct SignatureCache * fresh = (struct SignatureCache*)malloc(sizeof(struct SignatureCache));
+        pthread_mutex_init(&fresh->lock, 0);
+        arena_init(&fresh->arena, SIG_ARENA_CHUNK);
+        fresh->mask = 255;
+        fresh->used = 0;
+        fresh->entries = (struct SigEntry*)calloc(fresh->mask + 1, sizeof(struct SigEntry));
+
+        // concurrent first users may both build, the loser frees its copy
+        if (__atomic_compare_exchange_n(&context->signatures, &cache, fresh, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            cache = fresh;
+        } else {
+            pthread_mutex_destroy(&fresh->lock);
+            free(fresh->entries);
+            free(fresh);
+        }
+    }
+    return cache;
+}
+
+static inline uint32_t hash_key(uint64_t key)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdull;
+    key ^= key >> 33;
+    return (uint32_t)key;
+}
+
+static struct SigEntry * find_slot(struct SigEntry * entries, uint32_t mask, uint64_t key)
+{
+    uint32_t i = hash_key(key) & mask;
+    while (entries[i].key != 0 && entries[i].key != key) {
+        i = (i + 1) & mask;
+    }
+    return entries + i;
+}
+
+static void grow(struct SignatureCache * cache)
+{
+    uint32_t mask = cache->mask * 2 + 1;
+    struct SigEntry * entries = (struct SigEntry*)calloc(mask + 1, sizeof(struct SigEntry));
+
+    for (uint32_t i = 0; i <= cache->mask; i++) {
+        if (cache->entries[i].key) {
+            *find_slot(entries, mask, cache->entries[i].key) = cache->entries[i];
+        }
+    }
+
+    free(cache->entries);
+    cache->entries = entries;
+    cache->mask = mask;
+}
+
+static const struct Signature * get_signature(struct Context * context, uint32_t blob, int typeSpec)
+{
+    uint32_t len;
+    const char * ptr = clr_get_blob(context, blob, &len);
+    if (ptr == 0 || len == 0) {
+        return 0;
+    }
+
+    struct SignatureCache * cache = get_cache(context);
+    uint64_t key = (((uint64_t)blob << 1) | typeSpec) + 1;
+
+    pthread_mutex_lock(&cache->lock);
+
+    struct SigEntry * entry = find_slot(cache->entries, cache->mask, key);
+    if (entry->key == 0) {
+        struct SigReader reader = { context, &cache->arena, ptr, ptr + len, 0 };
+        const struct Signature * sig = decode(&reader, typeSpec);
+
+        // what the failed decode allocated stays in the arena, malformed
+        // blobs are rare
+        entry->key = key;
+        entry->sig = sig ? sig : &malformed;
+
+        if (++cache->used * 2 > cache->mask) {
+            grow(cache);
+            entry = find_slot(cache->entries, cache->mask, key);
+        }
+    }
+
+    const struct Signature * sig = entry->sig;
+    pthread_mutex_unlock(&cache->lock);
+
+    return (sig == &malformed) ? 0 : sig;
+}
+
+const struct Signature * clr_signature(struct Context * context, uint32_t blob)
+{
+    return get_signature(context, blob, 0);
+}
+
+const struct Signature * clr_typespec_signature(struct Context * context, uint32_t blob)
+{
+    return get_signature(context, blob, 1);
+}
+
+const struct Signature * clr_row_signature(struct Context * context, int table, uint32_t row)
+{
+    if (table < 0 || table >= 64 || row == 0 || row > context->tables[table].rowCount) {
+        return 0;
+    }
+
+    switch(table) {
+        case MethodDef:     return clr_signature(context, Row<MethodDef>(context->tables, row - 1).Signature());
+        case Field:         return clr_signature(context, Row<Field>(context->tables, row - 1).Signature());
+        case Property:      return clr_signature(context, Row<Property>(context->tables, row - 1).Type());
+        case MemberRef:     return clr_signature(context, Row<MemberRef>(context->tables, row - 1).Signature());
+        case StandAloneSig: return clr_signature(context, Row<StandAloneSig>(context->tables, row - 1).Signature());
+        case MethodSpec:    return clr_signature(context, Row<MethodSpec>(context->tables, row - 1).Instantiation());
+        case TypeSpec:      return clr_typespec_signature(context, Row<TypeSpec>(context->tables, row - 1).Signature());
+        default:            return 0;
+    }
+}
+
+void signature_free(struct Context * context)
+{
+    struct SignatureCache * cache = context->signatures;
+    if (cache == 0) {
+        return;
+    }
+
+    arena_free(&cache->arena);
+    pthread_mutex_destroy(&cache->lock);
+    free(cache->entries);
+    free(cache);
+    context->signatures = 0;
+}
+
+// formatting
+
+struct Writer {
+    char * buf;
+    size_t size;
+    size_t len;
+    int overflow;
+};
+
+static void put(struct Writer * w, const char * str)
+{
+    size_t n = strlen(str);
+    if (w->len + n >= w->size) {
+        w->overflow = 1;
+        return;
+    }
+    memcpy(w->buf + w->len, str, n + 1);
+    w->len += n;
+}
+
+static void put_int(struct Writer * w, int64_t value)
+{
+    char tmp[24];
+    snprintf(tmp, sizeof(tmp), "%lld", (long long)value);
+    put(w, tmp);
+}
+
+static void format_type(struct Context * context, const struct SigType * type, struct Writer * w, int depth);
+static void format_method(struct Context * context, const struct Signature * sig, struct Writer * w, int depth);
+
+static void format_token(struct Context * context, uint32_t token, struct Writer * w, int depth)
+{
+    int table = token >> 24;
+    uint32_t row = token & 0xFFFFFF;
+
+    if (table == TypeSpec) {
+        const struct Signature * spec = clr_row_signature(context, TypeSpec, row);
+        if (spec && depth < SIG_MAX_DEPTH) {
+            format_type(context, spec->type, w, depth + 1);
+        } else {
+            put(w, "<typespec>");
+        }
+        return;
+    }
+
+    char name[1024];
+    if (clr_type_name(context, table, row, name, sizeof(name)) < 0) {
+        snprintf(name, sizeof(name), "<%02x%06x>", table, row);
+    }
+    put(w, name);
+}
+
+static const char * simple_name(int element)
+{
+    switch(element) {
+        case ELEMENT_TYPE_VOID:       return "void";
+        case ELEMENT_TYPE_BOOLEAN:    return "bool";
+        case ELEMENT_TYPE_CHAR:       return "char";
+        case ELEMENT_TYPE_I1:         return "int8";
+        case ELEMENT_TYPE_U1:         return "uint8";
+        case ELEMENT_TYPE_I2:         return "int16";
+        case ELEMENT_TYPE_U2:         return "uint16";
+        case ELEMENT_TYPE_I4:         return "int32";
+        case ELEMENT_TYPE_U4:         return "uint32";
+        case ELEMENT_TYPE_I8:         return "int64";
+        case ELEMENT_TYPE_U8:         return "uint64";
+        case ELEMENT_TYPE_R4:         return "float32";
+        case ELEMENT_TYPE_R8:         return "float64";
+        case ELEMENT_TYPE_STRING:     return "string";
+        case ELEMENT_TYPE_TYPEDBYREF: return "typedref";
+        case ELEMENT_TYPE_I:          return "native int";
+        case ELEMENT_TYPE_U:          return "native uint";
+        case ELEMENT_TYPE_OBJECT:     return "object";
+        default:                      return 0;
+    }
+}
+
+static void format_type(struct Context * context, const struct SigType * type, struct Writer * w, int depth)
+{
+    const char * simple = simple_name(type->element);
+    if (simple) {
+        put(w, simple);
+    }
+
+    switch(type->element) {
+        case ELEMENT_TYPE_CLASS:
+        case ELEMENT_TYPE_VALUETYPE:
+            put(w, type->element == ELEMENT_TYPE_CLASS ? "class " : "valuetype ");
+            format_token(context, type->token, w, depth);
+            break;
+        case ELEMENT_TYPE_VAR:
+        case ELEMENT_TYPE_MVAR:
+            put(w, type->element == ELEMENT_TYPE_VAR ? "!" : "!!");
+            put_int(w, type->token);
+            break;
+        case ELEMENT_TYPE_PTR:
+        case ELEMENT_TYPE_BYREF:
+        case ELEMENT_TYPE_SZARRAY:
+        case ELEMENT_TYPE_PINNED:
+            format_type(context, type->inner, w, depth + 1);
+            put(w, type->element == ELEMENT_TYPE_PTR ? "*" : type->element == ELEMENT_TYPE_BYREF ? "&"
+                : type->element == ELEMENT_TYPE_SZARRAY ? "[]" : " pinned");
+            break;
+        case ELEMENT_TYPE_ARRAY: {
+            const struct SigArrayShape * shape = type->shape;
+            format_type(context, type->inner, w, depth + 1);
+            put(w, "[");
+            for (uint32_t i = 0; i < shape->rank; i++) {
+                if (i) {
+                    put(w, ",");
+                }
+                int hasBound = i < shape->boundCount, hasSize = i < shape->sizeCount;
+                if (hasBound) {
+                    put_int(w, shape->lowerBounds[i]);
+                    put(w, "...");
+                }
+                if (hasSize) {
+                    put_int(w, (int64_t)(hasBound ? shape->lowerBounds[i] : 0) + shape->sizes[i] - (hasBound ? 1 : 0));
+                }
+            }
+            put(w, "]");
+            break;
+        }
+        case ELEMENT_TYPE_GENERICINST:
+            format_type(context, type->inner, w, depth + 1);
+            put(w, "<");
+            for (uint32_t i = 0; i < type->argCount; i++) {
+                if (i) {
+                    put(w, ",");
+                }
+                format_type(context, type->args[i], w, depth + 1);
+            }
+            put(w, ">");
+            break;
+        case ELEMENT_TYPE_FNPTR:
+            put(w, "method ");
+            format_method(context, type->method, w, depth + 1);
+            break;
+        default:
+            break;
+    }
+
+    for (uint32_t i = 0; i < type->modCount; i++) {
+        put(w, type->mods[i].required ? " modreq(" : " modopt(");
+        format_token(context, type->mods[i].token, w, depth);
+        put(w, ")");
+    }
+}
+
+static void format_list(struct Context * context, const struct Signature * sig, struct Writer * w, int depth)
+{
+    for (uint32_t i = 0; i < sig->count; i++) {
+        if (i) {
+            put(w, ", ");
+        }
+        if ((int32_t)i == sig->sentinel) {
+            put(w, "..., ");
+        }
+        format_type(context, sig->types[i], w, depth + 1);
+    }
+}
+
+static void format_method(struct Context * context, const struct Signature * sig, struct Writer * w, int depth)
+{
+    if (sig->callingConvention & SIG_HASTHIS) {
+        put(w, "instance ");
+    }
+    if (sig->callingConvention & SIG_EXPLICITTHIS) {
+        put(w, "explicit ");
+    }
+    if ((sig->callingConvention & SIG_KIND_MASK) == SIG_VARARG) {
+        put(w, "vararg ");
+    }
+
+    format_type(context, sig->type, w, depth + 1);
+
+    if (sig->genericCount) {
+        put(w, " <[");
+        put_int(w, sig->genericCount);
+        put(w, "]>");
+    }
+
+    put(w, " (");
+    format_list(context, sig, w, depth);
+    put(w, ")");
+}
+
+int sig_format_type(struct Context * context, const struct SigType * type, char * buf, size_t size)
+{
+    if (size == 0) {
+        return -1;
+    }
+
+    struct Writer w = { buf, size, 0, 0 };
+    buf[0] = 0;
+    format_type(context, type, &w, 0);
+
+    return w.overflow ? -1 : (int)w.len;
+}
+
+int sig_format(struct Context * context, const struct Signature * sig, char * buf, size_t size)
+{
+    if (size == 0) {
+        return -1;
+    }
+
+    struct Writer w = { buf, size, 0, 0 };
+    buf[0] = 0;
+
+    switch(sig->kind) {
+        case Sig_Method:
+        case Sig_Property:
+            format_method(context, sig, &w, 0);
+            break;
+        case Sig_Field:
+        case Sig_TypeSpec:
+            format_type(context, sig->type, &w, 0);
+            break;
+        case Sig_Locals:
+            put(&w, "(");
+            format_list(context, sig, &w, 0);
+            put(&w, ")");
+            break;
+        case Sig_MethodSpec:
+            put(&w, "<");
+            for (uint32_t i = 0; i < sig->count; i++) {
+                if (i) {
+                    put(&w, ",");
+                }
+                format_type(context, sig->types[i], &w, 1);
+            }
+            put(&w, ">");
+            break;
+    }
+
+    return w.overflow ? -1 : (int)w.len;
+}
@@ -0,0 +1,132 @@
+#ifndef _CLRPARSER_SIGNATURE_H_
+#define _CLRPARSER_SIGNATURE_H_
+
+#include <stdint.h>
+
+#include "clr.h"
+
+// ECMA-335 II.23.2 signatures of the #Blob heap, decoded on first request
+// and kept per Context until close_clr. a blob is decoded once no matter
+// how many rows or threads ask for it; the result is read only.
+
+enum ElementType {
+    ELEMENT_TYPE_END = 0x00,
+    ELEMENT_TYPE_VOID = 0x01,
+    ELEMENT_TYPE_BOOLEAN = 0x02,
+    ELEMENT_TYPE_CHAR = 0x03,
+    ELEMENT_TYPE_I1 = 0x04,
+    ELEMENT_TYPE_U1 = 0x05,
+    ELEMENT_TYPE_I2 = 0x06,
+    ELEMENT_TYPE_U2 = 0x07,
+    ELEMENT_TYPE_I4 = 0x08,
+    ELEMENT_TYPE_U4 = 0x09,
+    ELEMENT_TYPE_I8 = 0x0a,
+    ELEMENT_TYPE_U8 = 0x0b,
+    ELEMENT_TYPE_R4 = 0x0c,
+    ELEMENT_TYPE_R8 = 0x0d,
+    ELEMENT_TYPE_STRING = 0x0e,
+    ELEMENT_TYPE_PTR = 0x0f,
+    ELEMENT_TYPE_BYREF = 0x10,
+    ELEMENT_TYPE_VALUETYPE = 0x11,
+    ELEMENT_TYPE_CLASS = 0x12,
+    ELEMENT_TYPE_VAR = 0x13,
+    ELEMENT_TYPE_ARRAY = 0x14,
+    ELEMENT_TYPE_GENERICINST = 0x15,
+    ELEMENT_TYPE_TYPEDBYREF = 0x16,
+    ELEMENT_TYPE_I = 0x18,
+    ELEMENT_TYPE_U = 0x19,
+    ELEMENT_TYPE_FNPTR = 0x1b,
+    ELEMENT_TYPE_OBJECT = 0x1c,
+    ELEMENT_TYPE_SZARRAY = 0x1d,
+    ELEMENT_TYPE_MVAR = 0x1e,
+    ELEMENT_TYPE_CMOD_REQD = 0x1f,
+    ELEMENT_TYPE_CMOD_OPT = 0x20,
+    ELEMENT_TYPE_SENTINEL = 0x41,
+    ELEMENT_TYPE_PINNED = 0x45,
+};
+
+// first byte of a signature
+enum CallingConvention {
+    SIG_DEFAULT = 0x00,
+    SIG_C = 0x01,
+    SIG_STDCALL = 0x02,
+    SIG_THISCALL = 0x03,
+    SIG_FASTCALL = 0x04,
+    SIG_VARARG = 0x05,
+    SIG_FIELD = 0x06,
+    SIG_LOCAL_SIG = 0x07,
+    SIG_PROPERTY = 0x08,
+    SIG_GENERICINST = 0x0a,
+    SIG_KIND_MASK = 0x0f,
+
+    SIG_GENERIC = 0x10,
+    SIG_HASTHIS = 0x20,
+    SIG_EXPLICITTHIS = 0x40,
+};
+
+enum SignatureKind {
+    Sig_Method,     // MethodDefSig, MethodRefSig, StandAloneMethodSig
+    Sig_Field,
+    Sig_Property,
+    Sig_Locals,     // LocalVarSig
+    Sig_MethodSpec,
+    Sig_TypeSpec,
+};
+
+struct SigModifier {
+    uint8_t required;   // modreq, else modopt
+    uint32_t token;     // TypeDef, TypeRef or TypeSpec
+};
+
+struct SigArrayShape {
+    uint32_t rank;
+    uint32_t sizeCount;
+    uint32_t boundCount;
+    const uint32_t * sizes;
+    const int32_t * lowerBounds;
+};
+
+struct Signature;
+
+struct SigType {
+    uint8_t element;                    // ElementType
+    uint8_t modCount;
+    uint32_t token;                     // CLASS, VALUETYPE: TypeDef, TypeRef or TypeSpec; VAR, MVAR: number
+    uint32_t argCount;                  // GENERICINST
+    const struct SigModifier * mods;    // custom modifiers in front of the type
+    const struct SigType * inner;       // PTR, BYREF, PINNED, SZARRAY, ARRAY: element; GENERICINST: the generic type
+    const struct SigType * const * args;   // GENERICINST
+    const struct SigArrayShape * shape; // ARRAY
+    const struct Signature * method;    // FNPTR
+};
+
+struct Signature {
+    uint8_t kind;                       // SignatureKind
+    uint8_t callingConvention;          // the first byte, 0 for a TypeSpec
+    uint32_t genericCount;              // SIG_GENERIC methods
+    uint32_t count;                     // parameters, locals or generic arguments
+    int32_t sentinel;                   // index of the first vararg parameter, -1 if none
+    const struct SigType * type;        // return type, field, property or TypeSpec type
+    const struct SigType * const * types; // the count parameters, locals or arguments
+};
+
+// the signature at index of the #Blob heap, its kind taken from the
+// calling convention byte. 0 if the blob is malformed.
+const struct Signature * clr_signature(struct Context * context, uint32_t blob);
+
+// the blob of a TypeSpec row, which has no calling convention byte
+const struct Signature * clr_typespec_signature(struct Context * context, uint32_t blob);
+
+// the signature of a MethodDef, Field, Property, MemberRef, StandAloneSig,
+// TypeSpec or MethodSpec row
+const struct Signature * clr_row_signature(struct Context * context, int table, uint32_t row);
+
+// ILDasm like text of a type or signature into buf, e.g. "class
+// System.Collections.Generic.List`1<int32>" or "int32 (string, !!0[])".
+// returns the length, -1 if buf is too small.
+int sig_format_type(struct Context * context, const struct SigType * type, char * buf, size_t size);
+int sig_format(struct Context * context, const struct Signature * sig, char * buf, size_t size);
+
+void signature_free(struct Context * context);
+
+#endif
@@ -0,0 +1,425 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "symbol.h"
+#include "lookup.h"
+#include "owner.h"
+
+#define SYMBOL_MAX_NESTING 64
+
+// one slot per distinct name of a table. the rows sharing it, every .ctor
+// or value__, are chained in row order through next, so duplicates never
+// lengthen a probe run.
+struct SymbolEntry {
+    uint32_t key;   // name hash mixed with the table
+    uint32_t token; // table << 24 | first row, 0 for an empty slot
+    uint32_t last;  // table << 24 | last row of the chain
+};
+
+static const int symbol_tables [] = { TypeDef, TypeRef, ExportedType, MethodDef, Field };
+
+#define SYMBOL_TABLE_COUNT (sizeof(symbol_tables) / sizeof(symbol_tables[0]))
+
+struct SymbolIndex {
+    struct SymbolEntry * entries;
+    uint32_t mask;
+    uint32_t * next;                     // row after each row with the same name, 0 at the end
+    uint32_t base[SYMBOL_TABLE_COUNT];   // first next of each table
+};
+
+// FNV-1a, so the hash of a name built from pieces is the hash of the
+// pieces fed in order and a full type name never has to be assembled
+#define HASH_SEED 2166136261u
+
+static inline uint32_t hash_bytes(uint32_t h, const char * ptr, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ (uint8_t)ptr[i]) * 16777619u;
+    }
+    return h;
+}
+
+static inline uint32_t mix_key(uint32_t h, int table)
+{
+    h ^= (uint32_t)table * 0x9E3779B1u;
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    return h;
+}
+
+struct Name {
+    const char * ptr;
+    size_t len;
+};
+
+static struct Name heap_name(struct Context * context, uint32_t index)
+{
+    struct Name name = { "", 0 };
+    if (index < context->stringHeap.size) {
+        name.ptr = context->stringHeap.ptr + index;
+        name.len = strnlen(name.ptr, context->stringHeap.size - index);
+    }
+    return name;
+}
+
+// namespace and name of a type row, and the row of the enclosing type in
+// the same table, 0 for a top level type
+static void type_parts(struct Context * context, int table, uint32_t row, struct Name * ns, struct Name * name, uint32_t * outer)
+{
+    int tab = 0;
+    *outer = 0;
+
+    switch(table) {
+        case TypeDef: {
+            Row<TypeDef> type(context->tables, row - 1);
+            *ns = heap_name(context, type.TypeNamespace());
+            *name = heap_name(context, type.TypeName());
+
+            struct RowRange range;
+            if (clr_lookup_rows(context, NestedClass, NestedClassColumns::c_NestedClass, row, &range) == 0 && range.count > 0) {
+                *outer = Row<NestedClass>(context->tables, row_range_at(&range, 0) - 1).EnclosingClass();
+            }
+            break;
+        }
+        case TypeRef: {
+            Row<TypeRef> type(context->tables, row - 1);
+            *ns = heap_name(context, type.TypeNamespace());
+            *name = heap_name(context, type.TypeName());
+
+            uint32_t scope = type.ResolutionScope(&tab);
+            *outer = (tab == TypeRef) ? scope : 0;
+            break;
+        }
+        case ExportedType: {
+            Row<ExportedType> type(context->tables, row - 1);
+            *ns = heap_name(context, type.TypeNamespace());
+            *name = heap_name(context, type.TypeName());
+
+            uint32_t impl = type.Implementation(&tab);
+            *outer = (tab == ExportedType) ? impl : 0;
+            break;
+        }
+        default:
+            assert(0);
+    }
+
+    if (*outer > context->tables[table].rowCount) {
+        *outer = 0;
+    }
+}
+
+static uint32_t type_hash(struct Context * context, int table, uint32_t row, int depth)
+{
+    struct Name ns, name;
+    uint32_t outer;
+    type_parts(context, table, row, &ns, &name, &outer);
+
+    uint32_t h = HASH_SEED;
+    if (outer && depth < SYMBOL_MAX_NESTING) {
+        h = type_hash(context, table, outer, depth + 1);
+        h = hash_bytes(h, "/", 1);
+    } else if (ns.len > 0) {
+        h = hash_bytes(h, ns.ptr, ns.len);
+        h = hash_bytes(h, ".", 1);
+    }
+
+    return hash_bytes(h, name.ptr, name.len);
+}
+
+static int type_match(struct Context * context, int table, uint32_t row, const char * query, size_t len, int depth)
+{
+    struct Name ns, name;
+    uint32_t outer;
+    type_parts(context, table, row, &ns, &name, &outer);
+
+    if (len < name.len || memcmp(query + len - name.len, name.ptr, name.len) != 0) {
+        return 0;
+    }
+    len -= name.len;
+
+    if (outer && depth < SYMBOL_MAX_NESTING) {
+        return len > 0 && query[len - 1] == '/' && type_match(context, table, outer, query, len - 1, depth + 1);
+    }
+
+    if (ns.len == 0) {
+        return len == 0;
+    }
+
+    return len == ns.len + 1 && query[ns.len] == '.' && memcmp(query, ns.ptr, ns.len) == 0;
+}
+
+static int type_name(struct Context * context, int table, uint32_t row, char * buf, size_t size, int depth)
+{
+    struct Name ns, name;
+    uint32_t outer;
+    type_parts(context, table, row, &ns, &name, &outer);
+
+    size_t len = 0;
+    if (outer && depth < SYMBOL_MAX_NESTING) {
+        int n = type_name(context, table, outer, buf, size, depth + 1);
+        if (n < 0) {
+            return -1;
+        }
+        len = n;
+        if (len + 1 >= size) {
+            return -1;
+        }
+        buf[len++] = '/';
+    } else if (ns.len > 0) {
+        if (ns.len + 1 >= size) {
+            return -1;
+        }
+        memcpy(buf, ns.ptr, ns.len);
+        len = ns.len;
+        buf[len++] = '.';
+    }
+
+    if (len + name.len >= size) {
+        return -1;
+    }
+    memcpy(buf + len, name.ptr, name.len);
+    len += name.len;
+    buf[len] = 0;
+
+    return len;
+}
+
+int clr_type_name(struct Context * context, int table, uint32_t row, char * buf, size_t size)
+{
+    if ((table != TypeDef && table != TypeRef && table != ExportedType) || row == 0 || row > context->tables[table].rowCount || size == 0) {
+        return -1;
+    }
+    return type_name(context, table, row, buf, size, 0);
+}
+
+static struct Name member_name(struct Context * context, int table, uint32_t row)
+{
+    uint32_t index = (table == MethodDef) ? Row<MethodDef>(context->tables, row - 1).Name() : Row<Field>(context->tables, row - 1).Name();
+    return heap_name(context, index);
+}
+
+static int symbol_match(struct Context * context, uint32_t token, const char * query, size_t len)
+{
+    int table = token >> 24;
+    uint32_t row = token & 0xFFFFFF;
+
+    if (table == MethodDef || table == Field) {
+        struct Name name = member_name(context, table, row);
+        return name.len == len && memcmp(name.ptr, query, len) == 0;
+    }
+
+    return type_match(context, table, row, query, len, 0);
+}
+
+// whether two rows of one table have the same name. a type name too long
+// to spell out compares unequal and takes a slot of its own, which find
+// still visits.
+static int same_name(struct Context * context, uint32_t a, uint32_t b)
+{
+    int table = a >> 24;
+    if (table == MethodDef || table == Field) {
+        struct Name x = member_name(context, table, a & 0xFFFFFF);
+        struct Name y = member_name(context, table, b & 0xFFFFFF);
+        return x.len == y.len && (x.ptr == y.ptr || memcmp(x.ptr, y.ptr, x.len) == 0);
+    }
+
+    char buf[1024];
+    int len = type_name(context, table, b & 0xFFFFFF, buf, sizeof(buf), 0);
+    return len >= 0 && type_match(context, table, a & 0xFFFFFF, buf, len, 0);
+}
+
+static uint32_t * next_of(const struct SymbolIndex * index, uint32_t token)
+{
+    int table = token >> 24;
+    for (int i = 0; i < (int)SYMBOL_TABLE_COUNT; i++) {
+        if (symbol_tables[i] == table) {
+            return index->next + index->base[i] + (token & 0xFFFFFF) - 1;
+        }
+    }
+    assert(0);
+    return 0;
+}
+
+// rows are inserted in ascending order, so appending keeps chains sorted
+static void insert(struct Context * context, struct SymbolIndex * index, uint32_t key, uint32_t token)
+{
+    uint32_t slot = key & index->mask;
+    while (index->entries[slot].token != 0) {
+        struct SymbolEntry * entry = index->entries + slot;
+        if (entry->key == key && (entry->token >> 24) == (token >> 24) && same_name(context, entry->token, token)) {
+            *next_of(index, entry->last) = token;
+            entry->last = token;
+            return;
+        }
+        slot = (slot + 1) & index->mask;
+    }
+    index->entries[slot].key = key;
+    index->entries[slot].token = token;
+    index->entries[slot].last = token;
+}
+
+static struct SymbolIndex * build_symbols(struct Context * context)
+{
+    struct SymbolIndex * index = (struct SymbolIndex*)malloc(sizeof(struct SymbolIndex));
+
+    size_t count = 0;
+    for (int i = 0; i < (int)SYMBOL_TABLE_COUNT; i++) {
+        index->base[i] = count;
+        count += context->tables[symbol_tables[i]].rowCount;
+    }
+
+    // at most half full, linear probing stays short
+    uint32_t capacity = 16;
+    while (capacity < count * 2) {
+        capacity <<= 1;
+    }
+
+    index->entries = (struct SymbolEntry*)calloc(capacity, sizeof(struct SymbolEntry));
+    index->mask = capacity - 1;
+    index->next = (uint32_t*)calloc(count ? count : 1, sizeof(uint32_t));
+
+    for (int i = 0; i < (int)SYMBOL_TABLE_COUNT; i++) {
+        int table = symbol_tables[i];
+        uint32_t rows = context->tables[table].ptr ? context->tables[table].rowCount : 0;
+        for (uint32_t row = 1; row <= rows; row++) {
+            uint32_t h;
+            if (table == MethodDef || table == Field) {
+                struct Name name = member_name(context, table, row);
+                h = hash_bytes(HASH_SEED, name.ptr, name.len);
+            } else {
+                h = type_hash(context, table, row, 0);
+            }
+            insert(context, index, mix_key(h, table), (table << 24) | row);
+        }
+    }
+
+    return index;
+}
+
+static void free_symbols(struct SymbolIndex * index)
+{
+    if (index) {
+        free(index->entries);
+        free(index->next);
+        free(index);
+    }
+}
+
+// concurrent first users may both build, the loser frees its copy
+static const struct SymbolIndex * get_symbols(struct Context * context)
+{
+    struct SymbolIndex * index = __atomic_load_n(&context->symbols, __ATOMIC_ACQUIRE);
+    if (index == 0) {
+        struct SymbolIndex * fresh = build_symbols(context);
+        if (__atomic_compare_exchange_n(&context->symbols, &index, fresh, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            index = fresh;
+        } else {
+            free_symbols(fresh);
+        }
+    }
+    return index;
+}
+
+// calls found for every row of table matching name, in row order, until
+// found returns non zero
+static void find(struct Context * context, int table, const char * name, int (*found)(void * ctx, uint32_t row), void * ctx)
+{
+    const struct SymbolIndex * index = get_symbols(context);
+
+    size_t len = strlen(name);
+    uint32_t key = mix_key(hash_bytes(HASH_SEED, name, len), table);
+
+    for (uint32_t slot = key & index->mask; index->entries[slot].token != 0; slot = (slot + 1) & index->mask) {
+        const struct SymbolEntry * entry = index->entries + slot;
+        if (entry->key != key || (int)(entry->token >> 24) != table) {
+            continue;
+        }
+
+        if (!symbol_match(context, entry->token, name, len)) {
+            continue;
+        }
+
+        for (uint32_t token = entry->token; token != 0; token = *next_of(index, token)) {
+            if (found(ctx, token & 0xFFFFFF)) {
+                return;
+            }
+        }
+    }
+}
+
+static int found_first(void * ctx, uint32_t row)
+{
+    *(uint32_t*)ctx = row;
+    return 1;
+}
+
+uint32_t clr_find_type(struct Context * context, int table, const char * fullName)
+{
+    if (table != TypeDef && table != TypeRef && table != ExportedType) {
+        return 0;
+    }
+
+    uint32_t row = 0;
+    find(context, table, fullName, found_first, &row);
+    return row;
+}
+
+struct MemberMatches {
+    uint32_t * rows;
+    int max;
+    int count;
+};
+
+static int found_member(void * ctx, uint32_t row)
+{
+    struct MemberMatches * matches = (struct MemberMatches*)ctx;
+    if (matches->count < matches->max) {
+        matches->rows[matches->count] = row;
+    }
+    matches->count++;
+    return 0;
+}
+
+int clr_find_members(struct Context * context, int table, const char * name, uint32_t * rows, int max)
+{
+    if (table != MethodDef && table != Field) {
+        return 0;
+    }
+
+    struct MemberMatches matches = { rows, max, 0 };
+    find(context, table, name, found_member, &matches);
+    return matches.count;
+}
+
+// members of one type are a contiguous run, scanning it beats walking
+// every member of that name in the assembly
+uint32_t clr_find_type_member(struct Context * context, int table, uint32_t type, const char * name)
+{
+    if (table != MethodDef && table != Field) {
+        return 0;
+    }
+
+    uint32_t first, count;
+    if (clr_member_range(context, table, type, &first, &count) != 0) {
+        return 0;
+    }
+
+    size_t len = strlen(name);
+    for (uint32_t row = first; row < first + count; row++) {
+        struct Name member = member_name(context, table, row);
+        if (member.len == len && memcmp(member.ptr, name, len) == 0) {
+            return row;
+        }
+    }
+
+    return 0;
+}
+
+void symbol_free(struct Context * context)
+{
+    free_symbols(context->symbols);
+    context->symbols = 0;
+}
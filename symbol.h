@@ -0,0 +1,34 @@
+#ifndef _CLRPARSER_SYMBOL_H_
+#define _CLRPARSER_SYMBOL_H_
+
+#include <stdint.h>
+
+#include "clr.h"
+
+// name lookups through one flat open addressing table per Context, built
+// from the #Strings offsets of TypeDef, TypeRef, ExportedType, MethodDef
+// and Field on the first query and kept until close_clr. safe to call from
+// several threads.
+//
+// type names are "Namespace.Name", nested types "Namespace.Outer/Inner"
+// (NestedClass for TypeDef, the TypeRef resolution scope and the
+// ExportedType implementation for the others).
+
+// 1 based row of the TypeDef, TypeRef or ExportedType named fullName, the
+// first one if several share the name; 0 if there is none
+uint32_t clr_find_type(struct Context * context, int table, const char * fullName);
+
+// MethodDef or Field rows named name. up to max rows are stored, the
+// number of matches is returned.
+int clr_find_members(struct Context * context, int table, const char * name, uint32_t * rows, int max);
+
+// the member of the given TypeDef row named name, 0 if there is none
+uint32_t clr_find_type_member(struct Context * context, int table, uint32_t type, const char * name);
+
+// full name of a TypeDef, TypeRef or ExportedType row into buf, the same
+// form clr_find_type takes. returns the length, -1 if buf is too small.
+int clr_type_name(struct Context * context, int table, uint32_t row, char * buf, size_t size);
+
+void symbol_free(struct Context * context);
+
+#endif
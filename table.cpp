@@ -41,68 +41,67 @@ const char * table_init(struct Table * table, const struct FieldInfo * fields, c
     table->fields = fields; 
     table->cellSize = calc_cell_size(table);
 
+    size_t offset = 0;
+    for(int i = 0; i < TABLE_MAX_COLUMNS && fields[i].type; i++) {
+        table->offset[i] = offset;
+        table->width[i] = get_field_size(fields + i);
+        offset += table->width[i];
+    }
+
     table->ptr = ptr;
     table->rowCount = rowCount;
 
     return ptr + table->cellSize * rowCount;
 }
 
-void * table_get_field_ctx(struct Table * table, int row, const char * field) {
-	if (table->ptr == 0) {
-        return 0;
+int table_get_column(const struct Table * table, const char * field, struct Column * column) {
+    column->field = 0;
+    column->offset = 0;
+    column->size = 0;
+
+    if (table->fields == 0) {
+        return -1;
     }
 
-    const char * ptr = table->ptr + table->cellSize * row;
+    int offset = 0;
     for(int i = 0; table->fields[i].type; i++) {
-        if (strcmp(table->fields[i].name, field) != 0) {
-            ptr += get_field_size(table->fields + i);
-            continue;
+        if (strcmp(table->fields[i].name, field) == 0) {
+            column->field = table->fields + i;
+            column->offset = offset;
+            column->size = get_field_size(table->fields + i);
+            return 0;
         }
-		return table->fields[i].ctx;
-	}
+        offset += get_field_size(table->fields + i);
+    }
 
-	return 0;
+    return -1;
 }
 
-uint64_t table_get_field_u64(struct Table * table, int row, const char * field) {
-    if (table->ptr == 0) {
+// ctx belongs to the column, row is kept for the callers of the old scan
+void * table_get_field_ctx(struct Table * table, int row, const char * field) {
+    (void)row;
+
+    struct Column column;
+    if (table->ptr == 0 || table_get_column(table, field, &column) != 0) {
         return 0;
     }
+    return column.field->ctx;
+}
 
-    const char * ptr = table->ptr + table->cellSize * row;
-    for(int i = 0; table->fields[i].type; i++) {
-        if (strcmp(table->fields[i].name, field) != 0) {
-            ptr += get_field_size(table->fields + i);
-            continue;
-        }
-
-        switch(table->fields[i].size) {
-            case 1: return *(uint8_t*)ptr;
-            case 2: return *(uint16_t*)ptr;
-            case 4: return *(uint32_t*)ptr;
-            case 8: return *(uint64_t*)ptr;
-            default: return 0;
-        };
+uint64_t table_get_field_u64(struct Table * table, int row, const char * field) {
+    struct Column column;
+    if (table->ptr == 0 || table_get_column(table, field, &column) != 0) {
+        return 0;
     }
-    return 0;
+    return table_get_u64(table, row, &column);
 }
 
-
 const char * table_get_field_str(struct Table * table, int row, const char * field) {
-    if (table->ptr == 0) {
+    struct Column column;
+    if (table->ptr == 0 || table_get_column(table, field, &column) != 0) {
         return 0;
     }
-
-    const char * ptr = table->ptr  + table->cellSize * row;
-    for(int i = 0; table->fields[i].type; i++) {
-        if (strcmp(table->fields[i].name, field) != 0) {
-            ptr += get_field_size(table->fields + i);
-            continue;
-        }
-
-        return ptr;
-    }
-    return 0;
+    return table_get_cell(table, row, &column);
 }
 
 void table_parse(struct Table * table, void (*parser)(struct Table * table, int row, int col, const char * ptr, void * ctx), void * ctx)
@@ -122,74 +121,86 @@ void table_parse(struct Table * table, void (*parser)(struct Table * table, int
     }
 }
 
-static void hex(const char * ptr, size_t size)
-{
-    for (size_t i = 0; i < size; i++) {
-		if (i == 0) {
-			printf("%02X", (unsigned int)(unsigned char)(ptr[i]));
-		} else {
-			printf(" %02X", (unsigned int)(unsigned char)(ptr[i]));
-		}
-    }
-}
-
-
-
+struct TableDumper {
+    struct Output * out;
+    const char * title;
+    int lastRow;
+};
 
 static void dumper(struct Table * table, int row, int col, const char * ptr, void * ctx)
 {
     const struct FieldInfo * field = table->fields + col;
 
-    int * lastRow = (int*)ctx;
-    if (*lastRow != row) {
-        *lastRow = row;
-        printf("%d:\n", row);
+    struct TableDumper * td = (struct TableDumper*)ctx;
+    struct Output * out = td->out;
+    if (td->lastRow != row) {
+        if (td->lastRow != -1) {
+            output_end(out);
+        }
+        td->lastRow = row;
+        output_begin(out, "row");
+        output_meta_str(out, "table", td->title);
+        output_field_u64(out, "row", row);
+        output_text(out, ":");
+    }
+
+    output_text(out, "\n  ");
+    output_text(out, field->name);
+    output_text(out, " ");
+
+    uint64_t value = 0;
+    switch(field->size) {
+        case 1:  value = *(uint8_t *)ptr; break;
+        case 2:  value = *(uint16_t*)ptr; break;
+        case 4:  value = *(uint32_t*)ptr; break;
+        case 8:  value = *(uint64_t*)ptr; break;
     }
 
      switch(field->type) {
         case 'u':
-            switch(field->size) {
-                case 1:  printf("  %s %lu\n", field->name, (uint64_t)(*(uint8_t *)ptr)); break;
-                case 2:  printf("  %s %lu\n", field->name, (uint64_t)(*(uint16_t*)ptr)); break;
-                case 4:  printf("  %s %lu\n", field->name, (uint64_t)(*(uint32_t*)ptr)); break;
-                case 8:  printf("  %s %lu\n", field->name, (uint64_t)(*(uint64_t*)ptr)); break;
-                default: assert(0);
-            };
+            assert(field->size == 1 || field->size == 2 || field->size == 4 || field->size == 8);
+            output_field_u64(out, field->name, value);
             break;
         case 'x':
-            switch(field->size) {
-                case 1:  printf("  %s 0x%lx\n", field->name, (uint64_t)(*(uint8_t *)ptr)); break;
-                case 2:  printf("  %s 0x%lx\n", field->name, (uint64_t)(*(uint16_t*)ptr)); break;
-                case 4:  printf("  %s 0x%lx\n", field->name, (uint64_t)(*(uint32_t*)ptr)); break;
-                case 8:  printf("  %s 0x%lx\n", field->name, (uint64_t)(*(uint64_t*)ptr)); break;
-                default: assert(0);
-            };
+            assert(field->size == 1 || field->size == 2 || field->size == 4 || field->size == 8);
+            output_text(out, "0x");
+            output_field_hex(out, field->name, value, 0, OUTPUT_LOWER);
             break;
         case 's':
-            printf("  %s %s\n", field->name, ptr);
+            output_field_str(out, field->name, ptr);
             break;
         default:
-            printf("  %s [", field->name);
-            hex(ptr, field->size);
-            printf("]\n");
+            output_text(out, "[");
+            output_field_bytes(out, field->name, ptr, field->size, ' ');
+            output_text(out, "]");
             break;
      }
 }
 
-void table_dump(struct Table * table, const char * title) {
+void table_dump(struct Output * out, struct Table * table, const char * title) {
     if (table != 0) {
-        printf("-- %s --\n", title);
+        output_begin(out, "table");
+        output_text(out, "-- ");
+        output_field_str(out, "name", title);
+        output_text(out, " --");
+        output_end(out);
     }
 
     if (table->ptr == 0) {
-        printf(" null \n");
+        output_begin(out, "empty");
+        output_meta_str(out, "table", title);
+        output_text(out, " null ");
+        output_end(out);
         return;
     }
 
-    int lastRow = -1;
-    table_parse(table, dumper, &lastRow);
+    struct TableDumper td = { out, title, -1 };
+    table_parse(table, dumper, &td);
+    if (td.lastRow != -1) {
+        output_end(out);
+    }
 
-    printf("\n");
+    output_text(out, "\n");
 
     return;
 }
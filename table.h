@@ -2,6 +2,9 @@
 #define _CLRPARSER_HEADER_H_
 
 #include <stdlib.h>
+#include <stdint.h>
+
+#include "output.h"
 
 struct FieldInfo {
     char type;
@@ -10,21 +13,56 @@ struct FieldInfo {
 	void * ctx;
 };
 
+#define TABLE_MAX_COLUMNS 12
+
 struct Table {
     const struct FieldInfo * fields;
     const char * ptr;
     size_t cellSize;
     size_t rowCount;
+
+    // byte offset and width of every column, filled by table_init
+    uint8_t offset[TABLE_MAX_COLUMNS];
+    uint8_t width[TABLE_MAX_COLUMNS];
+};
+
+// a column resolved once by name, cells are then read without any lookup
+struct Column {
+    const struct FieldInfo * field; // 0 if the table has no such column
+    int offset;
+    int size;
 };
 
 const char * table_init(struct Table * table, const struct FieldInfo * fields, const char * ptr, int rowCount);
 
+int table_get_column(const struct Table * table, const char * field, struct Column * column);
+
+static inline const char * table_get_cell(const struct Table * table, int row, const struct Column * column) {
+    return table->ptr + table->cellSize * row + column->offset;
+}
+
+static inline uint64_t table_get_u64(const struct Table * table, int row, const struct Column * column) {
+    if (table->ptr == 0) {
+        return 0;
+    }
+
+    const char * ptr = table_get_cell(table, row, column);
+    switch(column->size) {
+        case 2: return *(uint16_t*)ptr;
+        case 4: return *(uint32_t*)ptr;
+        case 1: return *(uint8_t*)ptr;
+        case 8: return *(uint64_t*)ptr;
+        default: return 0;
+    }
+}
+
 // size_t       table_get_field_size(struct Table * table, int row, const char * field);
 
+// by name lookups, resolve a Column instead when reading many rows
 uint64_t     table_get_field_u64(struct Table * table, int row, const char * field);
 const char * table_get_field_str(struct Table * table, int row, const char * field);
 void *       table_get_field_ctx(struct Table * table, int row, const char * field);
 
-void table_dump(struct Table * table, const char * title);
+void table_dump(struct Output * out, struct Table * table, const char * title);
 
 #endif
@@ -0,0 +1,263 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "userstring.h"
+#include "arena.h"
+
+#define USER_STRING_PAGE_BITS 12
+#define USER_STRING_PAGE (1 << USER_STRING_PAGE_BITS)
+#define USER_STRING_ARENA_CHUNK (64 * 1024)
+
+struct UserStringEntry {
+    uint32_t len;
+    uint8_t flag;
+    char utf8[];
+};
+
+// entries by heap offset, in pages of USER_STRING_PAGE offsets allocated
+// when a string in them is first asked for. hits read the pages without
+// the lock; conversions hold it, for the arena and the scratch buffer.
+struct UserStringCache {
+    pthread_mutex_t lock;
+    struct Arena arena;
+    char * scratch;
+    size_t scratchSize;
+    uint32_t pageCount;
+    const struct UserStringEntry ** pages[];
+};
+
+size_t utf16_to_utf8(const char * src, size_t units, char * dst)
+{
+    char * out = dst;
+    size_t i = 0;
+
+    while (i < units) {
+        size_t stop = units;
+
+#ifdef __SSE2__
+        // runs of ASCII, 8 units at a time: no unit has a bit above 0x7F,
+        // so packing to bytes is the conversion
+        const __m128i high = _mm_set1_epi16((short)0xFF80);
+        const __m128i zero = _mm_setzero_si128();
+        while (i + 8 <= units) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(src + 2 * i));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, high), zero)) != 0xFFFF) {
+                break;
+            }
+            _mm_storel_epi64((__m128i*)out, _mm_packus_epi16(v, v));
+            out += 8;
+            i += 8;
+        }
+
+        // a block that is not all ASCII goes through the scalar loop
+        // before the next vector try
+        stop = (i + 8 < units) ? i + 8 : units;
+#endif
+
+        while (i < stop) {
+            uint16_t u;
+            memcpy(&u, src + 2 * i, 2);
+            uint32_t c = u;
+            i++;
+
+            if (c < 0x80) {
+                *out++ = (char)c;
+                continue;
+            }
+
+            if (c < 0x800) {
+                *out++ = (char)(0xC0 | (c >> 6));
+                *out++ = (char)(0x80 | (c & 0x3F));
+                continue;
+            }
+
+            if (c >= 0xD800 && c <= 0xDFFF) {
+                uint16_t low = 0;
+                if (c <= 0xDBFF && i < units) {
+                    memcpy(&low, src + 2 * i, 2);
+                }
+
+                if (low >= 0xDC00 && low <= 0xDFFF) {
+                    c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+                    i++;
+                    *out++ = (char)(0xF0 | (c >> 18));
+                    *out++ = (char)(0x80 | ((c >> 12) & 0x3F));
+                    *out++ = (char)(0x80 | ((c >> 6) & 0x3F));
+                    *out++ = (char)(0x80 | (c & 0x3F));
+                    continue;
+                }
+
+                c = 0xFFFD;
+            }
+
+            *out++ = (char)(0xE0 | (c >> 12));
+            *out++ = (char)(0x80 | ((c >> 6) & 0x3F));
+            *out++ = (char)(0x80 | (c & 0x3F));
+        }
+    }
+
+    return out - dst;
+}
+
+// the units and the trailing flag byte of the string at offset, its blob
+// size in *next. an even blob size has no flag byte.
+static int read_entry(struct Context * context, uint32_t offset, const char ** units, uint32_t * count, int * flag, uint32_t * next)
+{
+    const char * heap = context->unicodeHeap.ptr;
+    const char * end = heap + context->unicodeHeap.size;
+    if (offset >= context->unicodeHeap.size) {
+        return -1;
+    }
+
+    uint32_t len;
+    const char * ptr = read_compressed(heap + offset, end, &len);
+    if (ptr == 0 || len > (uint32_t)(end - ptr)) {
+        return -1;
+    }
+
+    *units = ptr;
+    *count = len / 2;
+    *flag = (len & 1) ? (uint8_t)ptr[len - 1] : 0;
+    *next = (ptr - heap) + len;
+    return 0;
+}
+
+static char * scratch(char ** buf, size_t * size, size_t need)
+{
+    if (*size < need) {
+        free(*buf);
+        *size = (need > 4096) ? need : 4096;
+        *buf = (char*)malloc(*size);
+    }
+    return *buf;
+}
+
+static struct UserStringCache * get_cache(struct Context * context)
+{
+    struct UserStringCache * cache = __atomic_load_n(&context->userStrings, __ATOMIC_ACQUIRE);
+    if (cache == 0) {
+        uint32_t pageCount = (context->unicodeHeap.size >> USER_STRING_PAGE_BITS) + 1;
+        struct UserStringCache * fresh = (struct UserStringCache*)calloc(1, sizeof(struct UserStringCache) + sizeof(void*) * pageCount);
+        pthread_mutex_init(&fresh->lock, 0);
+        arena_init(&fresh->arena, USER_STRING_ARENA_CHUNK);
+        fresh->pageCount = pageCount;
+
+        // concurrent first users may both build, the loser frees its copy
+        if (__atomic_compare_exchange_n(&context->userStrings, &cache, fresh, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            cache = fresh;
+        } else {
+            pthread_mutex_destroy(&fresh->lock);
+            free(fresh);
+        }
+    }
+    return cache;
+}
+
+const char * clr_user_string(struct Context * context, uint32_t token, uint32_t * len, int * flag)
+{
+    uint32_t offset = token & 0x00FFFFFF;
+    if (offset >= context->unicodeHeap.size) {
+        return 0;
+    }
+
+    struct UserStringCache * cache = get_cache(context);
+    const struct UserStringEntry ** page = __atomic_load_n(&cache->pages[offset >> USER_STRING_PAGE_BITS], __ATOMIC_ACQUIRE);
+    const struct UserStringEntry * entry = page ? __atomic_load_n(&page[offset & (USER_STRING_PAGE - 1)], __ATOMIC_ACQUIRE) : 0;
+
+    if (entry == 0) {
+        const char * units;
+        uint32_t count, next;
+        int f;
+        if (read_entry(context, offset, &units, &count, &f, &next) != 0) {
+            return 0;
+        }
+
+        pthread_mutex_lock(&cache->lock);
+
+        if (page == 0 && (page = cache->pages[offset >> USER_STRING_PAGE_BITS]) == 0) {
+            page = (const struct UserStringEntry**)arena_alloc(&cache->arena, sizeof(void*) * USER_STRING_PAGE);
+            __atomic_store_n(&cache->pages[offset >> USER_STRING_PAGE_BITS], page, __ATOMIC_RELEASE);
+        }
+
+        entry = page[offset & (USER_STRING_PAGE - 1)];
+        if (entry == 0) {
+            char * buf = scratch(&cache->scratch, &cache->scratchSize, (size_t)count * 3);
+            size_t n = utf16_to_utf8(units, count, buf);
+
+            struct UserStringEntry * fresh = (struct UserStringEntry*)arena_alloc(&cache->arena, sizeof(struct UserStringEntry) + n + 1);
+            fresh->len = n;
+            fresh->flag = f;
+            memcpy(fresh->utf8, buf, n);
+
+            __atomic_store_n(&page[offset & (USER_STRING_PAGE - 1)], fresh, __ATOMIC_RELEASE);
+            entry = fresh;
+        }
+
+        pthread_mutex_unlock(&cache->lock);
+    }
+
+    if (len) {
+        *len = entry->len;
+    }
+    if (flag) {
+        *flag = entry->flag;
+    }
+    return entry->utf8;
+}
+
+int clr_for_each_user_string(struct Context * context, UserStringCallback callback, void * arg)
+{
+    char * buf = 0;
+    size_t size = 0;
+    int ret = 0;
+
+    // offset 0 is the empty string; zero bytes are also the padding at the
+    // end of the heap
+    uint32_t offset = 1;
+    while (offset < context->unicodeHeap.size) {
+        const char * units;
+        uint32_t count, next;
+        int flag;
+        if (read_entry(context, offset, &units, &count, &flag, &next) != 0) {
+            break;
+        }
+
+        if (next == offset + 1) {
+            offset = next;
+            continue;
+        }
+
+        char * out = scratch(&buf, &size, (size_t)count * 3 + 1);
+        size_t n = utf16_to_utf8(units, count, out);
+        out[n] = 0;
+
+        if ((ret = callback(arg, offset, out, n, flag)) != 0) {
+            break;
+        }
+        offset = next;
+    }
+
+    free(buf);
+    return ret;
+}
+
+void userstring_free(struct Context * context)
+{
+    struct UserStringCache * cache = context->userStrings;
+    if (cache == 0) {
+        return;
+    }
+
+    arena_free(&cache->arena);
+    pthread_mutex_destroy(&cache->lock);
+    free(cache->scratch);
+    free(cache);
+    context->userStrings = 0;
+}
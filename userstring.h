@@ -0,0 +1,32 @@
+#ifndef _CLRPARSER_USERSTRING_H_
+#define _CLRPARSER_USERSTRING_H_
+
+#include <stdint.h>
+
+#include "clr.h"
+
+// ECMA-335 II.24.2.4 #US heap: blobs of UTF-16LE code units followed by
+// one byte that is 1 if any unit has its top byte set or is one of a few
+// control characters. strings are handed out as UTF-8.
+
+#define USER_STRING_TOKEN 0x70000000
+
+// the ldstr token or #US offset as NUL terminated UTF-8, converted on first
+// use and kept until close_clr; len and flag may be 0. safe to call from
+// several threads. 0 if the offset does not start a string in the heap.
+const char * clr_user_string(struct Context * context, uint32_t token, uint32_t * len, int * flag);
+
+// every string of the heap in order, without filling the cache. utf8 is
+// only valid during the call. a non zero return of the callback stops the
+// walk and is returned.
+typedef int (*UserStringCallback)(void * arg, uint32_t offset, const char * utf8, uint32_t len, int flag);
+int clr_for_each_user_string(struct Context * context, UserStringCallback callback, void * arg);
+
+// units UTF-16LE code units at src to UTF-8 at dst, which needs room for
+// 3 bytes per unit. lone surrogates become U+FFFD. returns the bytes
+// written, no NUL is added.
+size_t utf16_to_utf8(const char * src, size_t units, char * dst);
+
+void userstring_free(struct Context * context);
+
+#endif
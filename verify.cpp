@@ -0,0 +1,713 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "verify.h"
+#include "il.h"
+#include "owner.h"
+#include "symbol.h"
+#include "signature.h"
+
+#define VERIFY_ARENA_CHUNK (64 * 1024)
+
+// per code offset
+#define MARK_INSN 0x1
+#define MARK_TRY  0x2
+
+#define NO_DEPTH 0xFFFF
+
+// the stack at an offset a forward branch or an exception handler leads to
+struct State {
+    uint16_t depth;
+    uint8_t types[];
+};
+
+struct Interp {
+    struct Context * context;
+    const struct ILMethodBody * body;
+    struct Arena * scratch;
+
+    const struct Signature * method;
+    const struct Signature * locals;
+    uint8_t thisType;           // 0 for methods without this
+
+    uint8_t * stack;            // declaredMaxStack slots
+    uint16_t depth;
+    uint16_t deepest;
+
+    uint8_t * marks;            // MARK_*
+    uint16_t * seenDepth;       // at instructions already passed, NO_DEPTH elsewhere
+    struct State ** states;
+};
+
+void verify_builder_init(struct VerifyBuilder * builder)
+{
+    arena_init(&builder->scratch, VERIFY_ARENA_CHUNK);
+}
+
+void verify_builder_free(struct VerifyBuilder * builder)
+{
+    arena_free(&builder->scratch);
+}
+
+static uint8_t stack_type(const struct SigType * type)
+{
+    if (type == 0) {
+        return STACK_ANY;
+    }
+
+    switch (type->element) {
+        case ELEMENT_TYPE_BOOLEAN:
+        case ELEMENT_TYPE_CHAR:
+        case ELEMENT_TYPE_I1:
+        case ELEMENT_TYPE_U1:
+        case ELEMENT_TYPE_I2:
+        case ELEMENT_TYPE_U2:
+        case ELEMENT_TYPE_I4:
+        case ELEMENT_TYPE_U4:
+            return STACK_I4;
+        case ELEMENT_TYPE_I8:
+        case ELEMENT_TYPE_U8:
+            return STACK_I8;
+        case ELEMENT_TYPE_R4:
+        case ELEMENT_TYPE_R8:
+            return STACK_F;
+        case ELEMENT_TYPE_I:
+        case ELEMENT_TYPE_U:
+        case ELEMENT_TYPE_PTR:
+        case ELEMENT_TYPE_FNPTR:
+            return STACK_I;
+        case ELEMENT_TYPE_BYREF:
+            return STACK_PTR;
+        case ELEMENT_TYPE_STRING:
+        case ELEMENT_TYPE_CLASS:
+        case ELEMENT_TYPE_OBJECT:
+        case ELEMENT_TYPE_SZARRAY:
+        case ELEMENT_TYPE_ARRAY:
+            return STACK_O;
+        case ELEMENT_TYPE_VALUETYPE:
+        case ELEMENT_TYPE_TYPEDBYREF:
+            return STACK_VALUE;
+        case ELEMENT_TYPE_GENERICINST:
+            return (type->inner && type->inner->element == ELEMENT_TYPE_VALUETYPE) ? STACK_VALUE : STACK_O;
+        case ELEMENT_TYPE_PINNED:
+            return stack_type(type->inner);
+        default:
+            return STACK_ANY;
+    }
+}
+
+// STACK_O or STACK_VALUE for a TypeDef or TypeSpec; what a TypeRef
+// stands for is up to the assembly defining it
+static uint8_t type_kind(struct Context * context, int table, uint32_t row)
+{
+    if (table < 0 || table >= 64 || row == 0 || row > (uint32_t)context->tables[table].rowCount) {
+        return STACK_ANY;
+    }
+
+    if (table == TypeSpec) {
+        const struct Signature * spec = clr_row_signature(context, TypeSpec, row);
+        return spec ? stack_type(spec->type) : (uint8_t)STACK_ANY;
+    }
+    if (table != TypeDef) {
+        return STACK_ANY;
+    }
+
+    int base;
+    uint32_t extends = Row<TypeDef>(context->tables, row - 1).Extends(&base);
+    if (extends == 0 || (base != TypeDef && base != TypeRef)) {
+        return STACK_O;
+    }
+
+    char name[32];
+    if (clr_type_name(context, base, extends, name, sizeof(name)) < 0) {
+        return STACK_O;
+    }
+    return (strcmp(name, "System.ValueType") == 0 || strcmp(name, "System.Enum") == 0) ? STACK_VALUE : STACK_O;
+}
+
+static uint8_t token_kind(struct Context * context, uint32_t token)
+{
+    return type_kind(context, token >> 24, token & 0xFFFFFF);
+}
+
+// signature of the method a call, newobj or calli token names
+static const struct Signature * method_signature(struct Context * context, uint32_t token)
+{
+    int table = token >> 24;
+    uint32_t row = token & 0xFFFFFF;
+
+    if (table == MethodSpec) {
+        if (row == 0 || row > (uint32_t)context->tables[MethodSpec].rowCount) {
+            return 0;
+        }
+        row = Row<MethodSpec>(context->tables, row - 1).Method(&table);
+    }
+    if (table != MethodDef && table != MemberRef && table != StandAloneSig) {
+        return 0;
+    }
+
+    const struct Signature * sig = clr_row_signature(context, table, row);
+    return (sig && sig->kind == Sig_Method) ? sig : 0;
+}
+
+static uint8_t field_type(struct Context * context, uint32_t token)
+{
+    int table = token >> 24;
+    if (table != Field && table != MemberRef) {
+        return STACK_ANY;
+    }
+
+    const struct Signature * sig = clr_row_signature(context, table, token & 0xFFFFFF);
+    return (sig && sig->kind == Sig_Field) ? stack_type(sig->type) : (uint8_t)STACK_ANY;
+}
+
+// the type constructed by newobj
+static uint8_t ctor_kind(struct Context * context, uint32_t token)
+{
+    int table = token >> 24;
+    uint32_t row = token & 0xFFFFFF;
+
+    if (table == MethodDef) {
+        return type_kind(context, TypeDef, clr_member_owner(context, MethodDef, row));
+    }
+    if (table == MemberRef && row > 0 && row <= (uint32_t)context->tables[MemberRef].rowCount) {
+        int parent;
+        row = Row<MemberRef>(context->tables, row - 1).Class(&parent);
+        return type_kind(context, parent, row);
+    }
+    return STACK_ANY;
+}
+
+static uint8_t arg_type(const struct Interp * in, uint32_t n)
+{
+    if (in->thisType) {
+        if (n == 0) {
+            return in->thisType;
+        }
+        n--;
+    }
+    return (in->method && n < in->method->count) ? stack_type(in->method->types[n]) : (uint8_t)STACK_ANY;
+}
+
+static uint8_t local_type(const struct Interp * in, uint32_t n)
+{
+    return (in->locals && n < in->locals->count) ? stack_type(in->locals->types[n]) : (uint8_t)STACK_ANY;
+}
+
+// III.1.5 binary numeric operations, pointer arithmetic included
+static uint8_t arith_type(uint8_t a, uint8_t b)
+{
+    if (a == b) {
+        return a;
+    }
+    if ((a == STACK_I4 || a == STACK_I) && (b == STACK_I4 || b == STACK_I)) {
+        return STACK_I;
+    }
+    if (a == STACK_PTR && (b == STACK_I4 || b == STACK_I)) {
+        return STACK_PTR;
+    }
+    if (b == STACK_PTR && (a == STACK_I4 || a == STACK_I)) {
+        return STACK_PTR;
+    }
+    return STACK_ANY;
+}
+
+// what an instruction pushes in slot kind, given the slots it popped
+static uint8_t push_type(const struct Interp * in, const struct ILInstruction * insn, int kind, const uint8_t * popped, int pops)
+{
+    switch (kind) {
+        case SLOT_I:
+            switch (insn->opcode) {
+                case CEE_CONV_I: case CEE_CONV_U: case CEE_CONV_OVF_I: case CEE_CONV_OVF_U:
+                case CEE_CONV_OVF_I_UN: case CEE_CONV_OVF_U_UN: case CEE_LDIND_I: case CEE_LDELEM_I:
+                case CEE_LDLEN: case CEE_LOCALLOC: case CEE_LDFTN: case CEE_LDVIRTFTN:
+                    return STACK_I;
+                case CEE_LDARGA: case CEE_LDARGA_S: case CEE_LDLOCA: case CEE_LDLOCA_S:
+                case CEE_LDFLDA: case CEE_LDSFLDA: case CEE_LDELEMA: case CEE_UNBOX: case CEE_REFANYVAL:
+                    return STACK_PTR;
+                case CEE_ISINST:
+                    return STACK_O;
+                case CEE_LDTOKEN: case CEE_ARGLIST: case CEE_REFANYTYPE:
+                    return STACK_VALUE;
+                default:
+                    return STACK_I4;
+            }
+        case SLOT_I8:
+            return STACK_I8;
+        case SLOT_R4:
+        case SLOT_R8:
+            return STACK_F;
+        case SLOT_REF:
+            return STACK_O;
+        default:
+            break;
+    }
+
+    switch (insn->opcode) {
+        case CEE_LDARG_0: case CEE_LDARG_1: case CEE_LDARG_2: case CEE_LDARG_3:
+            return arg_type(in, insn->opcode - CEE_LDARG_0);
+        case CEE_LDARG_S: case CEE_LDARG:
+            return arg_type(in, insn->operand.var);
+        case CEE_LDLOC_0: case CEE_LDLOC_1: case CEE_LDLOC_2: case CEE_LDLOC_3:
+            return local_type(in, insn->opcode - CEE_LDLOC_0);
+        case CEE_LDLOC_S: case CEE_LDLOC:
+            return local_type(in, insn->operand.var);
+        case CEE_LDFLD: case CEE_LDSFLD:
+            return field_type(in->context, insn->operand.token);
+        case CEE_LDOBJ: case CEE_LDELEM: case CEE_UNBOX_ANY:
+            return token_kind(in->context, insn->operand.token);
+        case CEE_MKREFANY:
+            return STACK_VALUE;
+        case CEE_SHL: case CEE_SHR: case CEE_SHR_UN: case CEE_DUP:
+            return popped[0];
+        default:
+            if (pops == 2) {
+                return arith_type(popped[0], popped[1]);
+            }
+            return (pops == 1) ? popped[0] : (uint8_t)STACK_ANY;
+    }
+}
+
+// slots a call, callvirt, calli or newobj pops, and its result if any
+static int call_effect(const struct Interp * in, const struct ILInstruction * insn, int * pops, uint8_t * push)
+{
+    const struct Signature * sig = method_signature(in->context, insn->operand.token);
+    if (sig == 0) {
+        return -1;
+    }
+
+    *pops = sig->count;
+    if (insn->opcode == CEE_NEWOBJ) {
+        *push = ctor_kind(in->context, insn->operand.token);
+        return 0;
+    }
+
+    if ((sig->callingConvention & SIG_HASTHIS) && !(sig->callingConvention & SIG_EXPLICITTHIS)) {
+        (*pops)++;
+    }
+    if (insn->opcode == CEE_CALLI) {
+        (*pops)++;
+    }
+    *push = (sig->type && sig->type->element != ELEMENT_TYPE_VOID) ? stack_type(sig->type) : 0;
+
+    return 0;
+}
+
+static struct State * save_state(struct Interp * in, uint16_t depth, const uint8_t * types)
+{
+    struct State * state = (struct State*)arena_alloc(in->scratch, sizeof(struct State) + depth);
+    if (state) {
+        state->depth = depth;
+        memcpy(state->types, types, depth);
+    }
+    return state;
+}
+
+// the stack after insn flows to target
+static int flow_to(struct Interp * in, int64_t target, uint32_t offset, uint16_t depth, const uint8_t * types)
+{
+    uint32_t codeSize = in->body->codeSize;
+    if (target < 0 || target >= codeSize) {
+        return VERIFY_BAD_TARGET;
+    }
+
+    if (target <= offset) {
+        if (!(in->marks[target] & MARK_INSN)) {
+            return VERIFY_BAD_TARGET;
+        }
+        return (in->seenDepth[target] == depth) ? VERIFY_OK : VERIFY_MISMATCH;
+    }
+
+    struct State * state = in->states[target];
+    if (state == 0) {
+        in->states[target] = save_state(in, depth, types);
+        return in->states[target] ? VERIFY_OK : VERIFY_BAD_BODY;
+    }
+    if (state->depth != depth) {
+        return VERIFY_MISMATCH;
+    }
+    for (uint16_t i = 0; i < depth; i++) {
+        if (state->types[i] != types[i]) {
+            state->types[i] = STACK_ANY;
+        }
+    }
+    return VERIFY_OK;
+}
+
+static int set_handler(struct Interp * in, uint32_t offset, uint16_t depth)
+{
+    static const uint8_t exception[1] = { STACK_O };
+
+    if (offset >= in->body->codeSize) {
+        return VERIFY_BAD_TARGET;
+    }
+    if (in->states[offset] == 0) {
+        in->states[offset] = save_state(in, depth, exception);
+    }
+    return (in->states[offset] && in->states[offset]->depth == depth) ? VERIFY_OK : VERIFY_MISMATCH;
+}
+
+// runs the instruction at insn on in->stack
+static int step(struct Interp * in, const struct ILInstruction * insn)
+{
+    const struct OpCode * code = opCodes + insn->opcode;
+
+    int pops;
+    uint8_t callPush = 0;
+    if (insn->opcode == CEE_RET) {
+        pops = (in->method && in->method->type && in->method->type->element != ELEMENT_TYPE_VOID) ? 1 : 0;
+        if (in->depth != pops) {
+            return VERIFY_RETURN;
+        }
+    } else if (code->pop == VarPop) {
+        if (call_effect(in, insn, &pops, &callPush) != 0) {
+            return VERIFY_BAD_TOKEN;
+        }
+    } else {
+        pops = stack_count(code->pop);
+    }
+
+    if (pops > in->depth) {
+        return VERIFY_UNDERFLOW;
+    }
+
+    const uint8_t * popped = in->stack + in->depth - pops;
+    uint8_t pushed[2];
+    int pushes = 0;
+    if (code->push == VarPush || (code->pop == VarPop && insn->opcode == CEE_NEWOBJ)) {
+        if (callPush) {
+            pushed[pushes++] = callPush;
+        }
+    } else {
+        pushes = stack_count(code->push);
+        for (int i = 0; i < pushes; i++) {
+            pushed[i] = push_type(in, insn, stack_slot(code->push, i), popped, pops);
+        }
+    }
+
+    in->depth -= pops;
+    if (in->depth + pushes > in->body->maxStack) {
+        return VERIFY_OVERFLOW;
+    }
+    memcpy(in->stack + in->depth, pushed, pushes);
+    in->depth += pushes;
+    if (in->depth > in->deepest) {
+        in->deepest = in->depth;
+    }
+
+    // leave and endfinally empty the stack
+    if (insn->opcode == CEE_LEAVE || insn->opcode == CEE_LEAVE_S || insn->opcode == CEE_ENDFINALLY) {
+        in->depth = 0;
+    }
+
+    return VERIFY_OK;
+}
+
+static int run(struct Interp * in, struct StackInfo * info, uint32_t * offsets, uint16_t * depths, uint32_t * typeStart, uint8_t * types)
+{
+    const struct ILMethodBody * body = in->body;
+
+    struct ILReader reader;
+    il_reader_init(&reader, body->code, body->codeSize);
+
+    struct ILInstruction insn;
+    uint32_t n = 0;
+    uint32_t slots = 0;
+    int reachable = 1;
+    int ret;
+
+    while (il_next(&reader, &insn) > 0) {
+        uint32_t offset = insn.offset;
+        info->errorOffset = offset;
+
+        struct State * state = in->states[offset];
+        if (reachable && state) {
+            if (state->depth != in->depth) {
+                return VERIFY_MISMATCH;
+            }
+            for (uint16_t i = 0; i < in->depth; i++) {
+                if (state->types[i] != in->stack[i]) {
+                    in->stack[i] = STACK_ANY;
+                }
+            }
+        } else if (!reachable) {
+            in->depth = state ? state->depth : 0;
+            if (state) {
+                memcpy(in->stack, state->types, state->depth);
+            }
+        }
+
+        if ((in->marks[offset] & MARK_TRY) && in->depth != 0) {
+            return VERIFY_TRY_ENTRY;
+        }
+
+        in->marks[offset] |= MARK_INSN;
+        in->seenDepth[offset] = in->depth;
+        offsets[n] = offset;
+        depths[n] = in->depth;
+        typeStart[n] = slots;
+        memcpy(types + slots, in->stack, in->depth);
+        slots += in->depth;
+        n++;
+
+        if ((ret = step(in, &insn)) != VERIFY_OK) {
+            return ret;
+        }
+
+        if (insn.operandKind == InlineBrTarget || insn.operandKind == ShortInlineBrTarget) {
+            if ((ret = flow_to(in, il_branch_target(&insn), offset, in->depth, in->stack)) != VERIFY_OK) {
+                return ret;
+            }
+        } else if (insn.operandKind == InlineSwitch) {
+            for (uint32_t i = 0; i < insn.operand.count; i++) {
+                if ((ret = flow_to(in, il_switch_target(&insn, i), offset, in->depth, in->stack)) != VERIFY_OK) {
+                    return ret;
+                }
+            }
+        }
+
+        reachable = il_falls_through(&insn);
+    }
+    typeStart[n] = slots;
+
+    info->errorOffset = body->codeSize;
+    if (reachable) {
+        // falls off the end of the code
+        return VERIFY_BAD_BODY;
+    }
+
+    // forward branches into the middle of an instruction
+    for (uint32_t i = 0; i < body->codeSize; i++) {
+        if (in->states[i] && !(in->marks[i] & MARK_INSN)) {
+            info->errorOffset = i;
+            return VERIFY_BAD_TARGET;
+        }
+    }
+
+    return VERIFY_OK;
+}
+
+int verify_method(struct VerifyBuilder * builder, struct Context * context, uint32_t methodDef,
+        const struct ILMethodBody * body, struct Arena * arena, struct StackInfo * info)
+{
+    memset(info, 0, sizeof(struct StackInfo));
+    info->declaredMaxStack = body->maxStack;
+
+    struct Arena * scratch = &builder->scratch;
+    arena_reset(scratch);
+
+    uint32_t codeSize = body->codeSize;
+
+    // instructions first, so the per instruction arrays are sized once
+    struct ILReader reader;
+    il_reader_init(&reader, body->code, codeSize);
+    struct ILInstruction insn;
+    uint32_t count = 0;
+    int ret;
+    while ((ret = il_next(&reader, &insn)) > 0) {
+        count++;
+    }
+    if (ret < 0 || codeSize == 0) {
+        info->errorOffset = reader.offset;
+        info->result = VERIFY_BAD_BODY;
+        return info->result;
+    }
+
+    struct Interp in;
+    memset(&in, 0, sizeof(struct Interp));
+    in.context = context;
+    in.body = body;
+    in.scratch = scratch;
+    in.method = clr_row_signature(context, MethodDef, methodDef);
+    if (body->localVarSigTok >> 24 == StandAloneSig) {
+        in.locals = clr_row_signature(context, StandAloneSig, body->localVarSigTok & 0xFFFFFF);
+        if (in.locals && in.locals->kind != Sig_Locals) {
+            in.locals = 0;
+        }
+    }
+    if (in.method && (in.method->callingConvention & SIG_HASTHIS) && !(in.method->callingConvention & SIG_EXPLICITTHIS)) {
+        uint8_t kind = type_kind(context, TypeDef, clr_member_owner(context, MethodDef, methodDef));
+        in.thisType = (kind == STACK_VALUE) ? (uint8_t)STACK_PTR : kind;
+    }
+
+    in.stack = (uint8_t*)arena_alloc(scratch, body->maxStack + 1);
+    in.marks = (uint8_t*)arena_alloc(scratch, codeSize);
+    in.seenDepth = (uint16_t*)arena_alloc(scratch, sizeof(uint16_t) * codeSize);
+    in.states = (struct State**)arena_alloc(scratch, sizeof(struct State*) * codeSize);
+
+    uint32_t * offsets = (uint32_t*)arena_alloc(scratch, sizeof(uint32_t) * count);
+    uint16_t * depths = (uint16_t*)arena_alloc(scratch, sizeof(uint16_t) * count);
+    uint32_t * typeStart = (uint32_t*)arena_alloc(scratch, sizeof(uint32_t) * (count + 1));
+    uint8_t * types = (uint8_t*)arena_alloc(scratch, (size_t)count * body->maxStack + 1);
+
+    if (in.stack == 0 || in.marks == 0 || in.seenDepth == 0 || in.states == 0 ||
+            offsets == 0 || depths == 0 || typeStart == 0 || types == 0) {
+        info->result = VERIFY_BAD_BODY;
+        return info->result;
+    }
+    memset(in.seenDepth, 0xFF, sizeof(uint16_t) * codeSize);
+
+    ret = VERIFY_OK;
+    struct ILExceptionClause clause;
+    for (uint32_t i = 0; ret == VERIFY_OK && il_method_clause(body, i, &clause) == 0; i++) {
+        info->errorOffset = clause.handlerOffset;
+        if (clause.tryOffset < codeSize) {
+            in.marks[clause.tryOffset] |= MARK_TRY;
+        }
+        if (clause.flags & (IL_CLAUSE_FINALLY | IL_CLAUSE_FAULT)) {
+            ret = set_handler(&in, clause.handlerOffset, 0);
+        } else {
+            ret = set_handler(&in, clause.handlerOffset, 1);
+        }
+        if (ret == VERIFY_OK && (clause.flags & IL_CLAUSE_FILTER)) {
+            ret = set_handler(&in, clause.filterOffset, 1);
+        }
+    }
+
+    if (ret == VERIFY_OK) {
+        ret = run(&in, info, offsets, depths, typeStart, types);
+    }
+
+    info->maxStack = in.deepest;
+    info->result = ret;
+    if (ret != VERIFY_OK) {
+        return ret;
+    }
+    info->errorOffset = 0;
+
+    uint32_t slots = typeStart[count];
+    uint32_t * keptOffsets = (uint32_t*)arena_alloc(arena, sizeof(uint32_t) * count);
+    uint16_t * keptDepths = (uint16_t*)arena_alloc(arena, sizeof(uint16_t) * count);
+    uint32_t * keptStart = (uint32_t*)arena_alloc(arena, sizeof(uint32_t) * (count + 1));
+    uint8_t * keptTypes = (uint8_t*)arena_alloc(arena, slots + 1);
+    if (keptOffsets == 0 || keptDepths == 0 || keptStart == 0 || keptTypes == 0) {
+        info->result = VERIFY_BAD_BODY;
+        return info->result;
+    }
+
+    memcpy(keptOffsets, offsets, sizeof(uint32_t) * count);
+    memcpy(keptDepths, depths, sizeof(uint16_t) * count);
+    memcpy(keptStart, typeStart, sizeof(uint32_t) * (count + 1));
+    memcpy(keptTypes, types, slots);
+
+    info->count = count;
+    info->offsets = keptOffsets;
+    info->depth = keptDepths;
+    info->typeStart = keptStart;
+    info->types = keptTypes;
+
+    return VERIFY_OK;
+}
+
+// per Context, one entry per MethodDef row. each entry is one malloc
+// block holding the StackInfo and its arrays.
+struct StackCache {
+    uint32_t count;
+    const struct StackInfo * infos[];
+};
+
+// remembered for methods without a body, so they are not tried again
+static const struct StackInfo nobody = { VERIFY_BAD_BODY, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+static struct StackCache * get_cache(struct Context * context)
+{
+    struct StackCache * cache = __atomic_load_n(&context->stacks, __ATOMIC_ACQUIRE);
+    if (cache == 0) {
+        uint32_t count = context->tables[MethodDef].rowCount + 1;
+        struct StackCache * fresh = (struct StackCache*)calloc(1, sizeof(struct StackCache) + sizeof(void*) * count);
+        fresh->count = count;
+
+        // concurrent first users may both build, the loser frees its copy
+        if (__atomic_compare_exchange_n(&context->stacks, &cache, fresh, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            cache = fresh;
+        } else {
+            free(fresh);
+        }
+    }
+    return cache;
+}
+
+#define ALIGN8(n) (((n) + 7) & ~(size_t)7)
+
+// info and the arrays it points to, copied into one block
+static struct StackInfo * keep_info(const struct StackInfo * info)
+{
+    uint32_t count = info->count;
+    uint32_t slots = count ? info->typeStart[count] : 0;
+
+    size_t offsetsAt = ALIGN8(sizeof(struct StackInfo));
+    size_t startAt = ALIGN8(offsetsAt + sizeof(uint32_t) * count);
+    size_t depthAt = ALIGN8(startAt + sizeof(uint32_t) * (count + 1));
+    size_t typesAt = depthAt + sizeof(uint16_t) * count;
+
+    char * block = (char*)malloc(typesAt + slots + 1);
+    if (block == 0) {
+        return 0;
+    }
+
+    struct StackInfo * kept = (struct StackInfo*)block;
+    *kept = *info;
+    if (count > 0) {
+        kept->offsets = (uint32_t*)memcpy(block + offsetsAt, info->offsets, sizeof(uint32_t) * count);
+        kept->typeStart = (uint32_t*)memcpy(block + startAt, info->typeStart, sizeof(uint32_t) * (count + 1));
+        kept->depth = (uint16_t*)memcpy(block + depthAt, info->depth, sizeof(uint16_t) * count);
+        kept->types = (uint8_t*)memcpy(block + typesAt, info->types, slots);
+    }
+    return kept;
+}
+
+// methods are verified without a lock, each call with its own builder;
+// when two threads verify the same method the loser frees its copy
+const struct StackInfo * clr_method_stack(struct Context * context, uint32_t methodDef)
+{
+    if (methodDef == 0 || methodDef > (uint32_t)context->tables[MethodDef].rowCount) {
+        return 0;
+    }
+
+    struct StackCache * cache = get_cache(context);
+    const struct StackInfo * info = __atomic_load_n(&cache->infos[methodDef], __ATOMIC_ACQUIRE);
+
+    if (info == 0) {
+        const struct StackInfo * fresh = &nobody;
+
+        struct ILMethodBody body;
+        if (clr_method_body(context, methodDef, &body) == 0) {
+            struct VerifyBuilder builder;
+            verify_builder_init(&builder);
+
+            struct StackInfo result;
+            verify_method(&builder, context, methodDef, &body, &builder.scratch, &result);
+            struct StackInfo * kept = keep_info(&result);
+            if (kept) {
+                fresh = kept;
+            }
+
+            verify_builder_free(&builder);
+        }
+
+        if (__atomic_compare_exchange_n(&cache->infos[methodDef], &info, fresh, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            info = fresh;
+        } else if (fresh != &nobody) {
+            free((void*)fresh);
+        }
+    }
+
+    return (info == &nobody) ? 0 : info;
+}
+
+void verify_free(struct Context * context)
+{
+    struct StackCache * cache = context->stacks;
+    if (cache == 0) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < cache->count; i++) {
+        if (cache->infos[i] != &nobody) {
+            free((void*)cache->infos[i]);
+        }
+    }
+    free(cache);
+    context->stacks = 0;
+}
@@ -0,0 +1,72 @@
+#ifndef _CLRPARSER_VERIFY_H_
+#define _CLRPARSER_VERIFY_H_
+
+#include <stdint.h>
+
+#include "arena.h"
+#include "clr.h"
+#include "il_method.h"
+
+// the evaluation stack of a method body, worked out in one forward pass
+// as ECMA-335 III.1.7.5 allows: an instruction that is reached neither
+// by falling through nor by a forward branch starts with an empty stack.
+// depths must agree wherever paths join and stay within MaxStack; the
+// types are those of III.1.1, merged to STACK_ANY where paths disagree.
+
+enum StackType {
+    STACK_I4 = 1,
+    STACK_I8 = 2,
+    STACK_I = 3,        // native int, also unmanaged pointers
+    STACK_F = 4,
+    STACK_O = 5,        // object reference
+    STACK_PTR = 6,      // managed pointer
+    STACK_VALUE = 7,    // value type
+    STACK_ANY = 8,      // not known from the metadata of this assembly
+};
+
+enum VerifyResult {
+    VERIFY_OK = 0,
+    VERIFY_BAD_BODY,    // the code does not decode
+    VERIFY_BAD_TARGET,  // a branch into an instruction or out of the code
+    VERIFY_BAD_TOKEN,   // a call or field whose signature does not decode
+    VERIFY_UNDERFLOW,
+    VERIFY_OVERFLOW,    // deeper than the MaxStack of the header
+    VERIFY_MISMATCH,    // paths join with different depths
+    VERIFY_RETURN,      // ret with more or less than the return value
+    VERIFY_TRY_ENTRY,   // a try block entered with a non-empty stack
+};
+
+struct StackInfo {
+    uint8_t result;             // VerifyResult
+    uint32_t errorOffset;       // of the failing instruction
+    uint16_t maxStack;          // deepest the stack gets, what a frame needs
+    uint16_t declaredMaxStack;
+
+    // per instruction, empty unless result is VERIFY_OK
+    uint32_t count;
+    const uint32_t * offsets;
+    const uint16_t * depth;     // before the instruction
+    const uint32_t * typeStart; // count + 1 entries into types
+    const uint8_t * types;      // StackType of each slot, the deepest first
+};
+
+// scratch memory reused from one method to the next
+struct VerifyBuilder {
+    struct Arena scratch;
+};
+
+void verify_builder_init(struct VerifyBuilder * builder);
+void verify_builder_free(struct VerifyBuilder * builder);
+
+// the stack of body, the code of MethodDef row methodDef, allocated from
+// arena. returns info->result.
+int verify_method(struct VerifyBuilder * builder, struct Context * context, uint32_t methodDef,
+        const struct ILMethodBody * body, struct Arena * arena, struct StackInfo * info);
+
+// the same, worked out when first asked for and kept until close_clr. 0
+// for methods without a body or whose body does not parse.
+const struct StackInfo * clr_method_stack(struct Context * context, uint32_t methodDef);
+
+void verify_free(struct Context * context);
+
+#endif
@@ -0,0 +1,665 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "workspace.h"
+#include "symbol.h"
+#include "owner.h"
+#include "signature.h"
+#include "attribute.h"
+
+#define WORKSPACE_MAX_CHAIN 32
+#define WORKSPACE_NAME_MAX 2048
+#define MEMO_SHARDS 16
+
+struct AssemblySlot {
+    struct Assembly assembly; // first, an Assembly * is its slot
+    pthread_mutex_t lock;
+    int state;                // 0 not tried yet, 1 loaded, -1 failed
+};
+
+struct MemoEntry {
+    const struct Assembly * from; // 0 for an empty slot
+    uint32_t token;
+    int status;
+    struct Resolved value;
+};
+
+struct MemoShard {
+    pthread_mutex_t lock;
+    struct MemoEntry * entries;
+    uint32_t mask;
+    uint32_t used;
+};
+
+struct Workspace {
+    char ** probe;
+    int probeCount;
+
+    pthread_mutex_t lock;
+    struct AssemblySlot ** slots;
+    int count;
+    int size;
+
+    struct MemoShard memo[MEMO_SHARDS];
+};
+
+static uint32_t memo_hash(const struct Assembly * from, uint32_t token)
+{
+    uint64_t h = (uint64_t)(uintptr_t)from * 0x9E3779B97F4A7C15ull ^ token;
+    h ^= h >> 29;
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 32;
+    return (uint32_t)h;
+}
+
+static int memo_get(struct Workspace * workspace, const struct Assembly * from, uint32_t token, struct Resolved * out)
+{
+    uint32_t h = memo_hash(from, token);
+    struct MemoShard * shard = workspace->memo + (h % MEMO_SHARDS);
+
+    int found = 0;
+    pthread_mutex_lock(&shard->lock);
+    if (shard->entries) {
+        for (uint32_t slot = (h / MEMO_SHARDS) & shard->mask; shard->entries[slot].from; slot = (slot + 1) & shard->mask) {
+            struct MemoEntry * entry = shard->entries + slot;
+            if (entry->from == from && entry->token == token) {
+                *out = entry->value;
+                found = (entry->status == 0) ? 1 : -1;
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&shard->lock);
+
+    return found;
+}
+
+static void memo_insert(struct MemoShard * shard, uint32_t h, const struct MemoEntry * entry)
+{
+    uint32_t slot = (h / MEMO_SHARDS) & shard->mask;
+    while (shard->entries[slot].from) {
+        if (shard->entries[slot].from == entry->from && shard->entries[slot].token == entry->token) {
+            return;
+        }
+        slot = (slot + 1) & shard->mask;
+    }
+    shard->entries[slot] = *entry;
+    shard->used++;
+}
+
+static void memo_put(struct Workspace * workspace, const struct Assembly * from, uint32_t token, int status, const struct Resolved * value)
+{
+    uint32_t h = memo_hash(from, token);
+    struct MemoShard * shard = workspace->memo + (h % MEMO_SHARDS);
+
+    pthread_mutex_lock(&shard->lock);
+
+    if (shard->entries == 0 || (shard->used + 1) * 2 > shard->mask + 1) {
+        uint32_t capacity = shard->entries ? (shard->mask + 1) * 2 : 64;
+        struct MemoEntry * old = shard->entries;
+        uint32_t oldCapacity = old ? shard->mask + 1 : 0;
+
+        shard->entries = (struct MemoEntry*)calloc(capacity, sizeof(struct MemoEntry));
+        shard->mask = capacity - 1;
+        shard->used = 0;
+
+        for (uint32_t i = 0; i < oldCapacity; i++) {
+            if (old[i].from) {
+                memo_insert(shard, memo_hash(old[i].from, old[i].token), old + i);
+            }
+        }
+        free(old);
+    }
+
+    struct MemoEntry entry = { from, token, status, { 0, 0 } };
+    if (value) {
+        entry.value = *value;
+    }
+    memo_insert(shard, h, &entry);
+
+    pthread_mutex_unlock(&shard->lock);
+}
+
+static int load_assembly(struct Assembly * assembly, const char * path)
+{
+    if (read_pe_file(&assembly->pe, path) != 0) {
+        return -1;
+    }
+
+    if (read_clr(&assembly->context, &assembly->pe) != 0) {
+        close_pe_file(&assembly->pe);
+        return -1;
+    }
+
+    assembly->path = strdup(path);
+    return 0;
+}
+
+static struct AssemblySlot * new_slot(const char * name)
+{
+    struct AssemblySlot * slot = (struct AssemblySlot*)calloc(1, sizeof(struct AssemblySlot));
+    slot->assembly.name = strdup(name);
+    pthread_mutex_init(&slot->lock, 0);
+    return slot;
+}
+
+static void free_slot(struct AssemblySlot * slot)
+{
+    if (slot->state == 1) {
+        close_clr(&slot->assembly.context);
+        close_pe_file(&slot->assembly.pe);
+    }
+    pthread_mutex_destroy(&slot->lock);
+    free((char*)slot->assembly.name);
+    free((char*)slot->assembly.path);
+    free(slot);
+}
+
+struct Workspace * workspace_open(const char ** probe, int count)
+{
+    struct Workspace * workspace = (struct Workspace*)calloc(1, sizeof(struct Workspace));
+
+    workspace->probe = (char**)calloc(count > 0 ? count : 1, sizeof(char*));
+    for (int i = 0; i < count; i++) {
+        workspace->probe[i] = strdup(probe[i]);
+    }
+    workspace->probeCount = count;
+
+    pthread_mutex_init(&workspace->lock, 0);
+    for (int i = 0; i < MEMO_SHARDS; i++) {
+        pthread_mutex_init(&workspace->memo[i].lock, 0);
+    }
+
+    return workspace;
+}
+
+void workspace_close(struct Workspace * workspace)
+{
+    if (workspace == 0) {
+        return;
+    }
+
+    for (int i = 0; i < workspace->count; i++) {
+        free_slot(workspace->slots[i]);
+    }
+    free(workspace->slots);
+
+    for (int i = 0; i < workspace->probeCount; i++) {
+        free(workspace->probe[i]);
+    }
+    free(workspace->probe);
+
+    for (int i = 0; i < MEMO_SHARDS; i++) {
+        pthread_mutex_destroy(&workspace->memo[i].lock);
+        free(workspace->memo[i].entries);
+    }
+
+    pthread_mutex_destroy(&workspace->lock);
+    free(workspace);
+}
+
+// workspace->lock must be held for both
+static struct AssemblySlot * find_slot(struct Workspace * workspace, const char * name)
+{
+    for (int i = 0; i < workspace->count; i++) {
+        if (strcasecmp(workspace->slots[i]->assembly.name, name) == 0) {
+            return workspace->slots[i];
+        }
+    }
+    return 0;
+}
+
+static void append_slot(struct Workspace * workspace, struct AssemblySlot * slot)
+{
+    if (workspace->count >= workspace->size) {
+        workspace->size = workspace->size ? workspace->size * 2 : 16;
+        workspace->slots = (struct AssemblySlot**)realloc(workspace->slots, sizeof(struct AssemblySlot*) * workspace->size);
+    }
+    workspace->slots[workspace->count++] = slot;
+}
+
+struct Assembly * workspace_add(struct Workspace * workspace, const char * path)
+{
+    struct AssemblySlot * slot = new_slot("");
+    if (load_assembly(&slot->assembly, path) != 0) {
+        free_slot(slot);
+        return 0;
+    }
+    slot->state = 1;
+
+    struct Context * context = &slot->assembly.context;
+    const char * name = "";
+    if (context->tables[Assembly].rowCount > 0) {
+        uint32_t index = Row<Assembly>(context->tables, 0).Name();
+        if (index < context->stringHeap.size) {
+            name = context->stringHeap.ptr + index;
+        }
+    }
+
+    free((char*)slot->assembly.name);
+    slot->assembly.name = strdup(name);
+
+    // an assembly of that name that is already there wins
+    pthread_mutex_lock(&workspace->lock);
+    struct AssemblySlot * existing = find_slot(workspace, name);
+    if (existing == 0) {
+        append_slot(workspace, slot);
+    }
+    pthread_mutex_unlock(&workspace->lock);
+
+    if (existing == 0) {
+        return &slot->assembly;
+    }
+
+    free_slot(slot);
+
+    // a probe that failed, or never ran, does not stop the explicit add.
+    // the file is loaded again in place: a Context points into itself and
+    // cannot be moved out of the scratch slot.
+    pthread_mutex_lock(&existing->lock);
+    int state = existing->state;
+    if (state != 1 && load_assembly(&existing->assembly, path) == 0) {
+        state = 1;
+        __atomic_store_n(&existing->state, state, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&existing->lock);
+
+    return state == 1 ? &existing->assembly : 0;
+}
+
+struct Assembly * workspace_load(struct Workspace * workspace, const char * name)
+{
+    pthread_mutex_lock(&workspace->lock);
+    struct AssemblySlot * slot = find_slot(workspace, name);
+    if (slot == 0) {
+        slot = new_slot(name);
+        append_slot(workspace, slot);
+    }
+    pthread_mutex_unlock(&workspace->lock);
+
+    int state = __atomic_load_n(&slot->state, __ATOMIC_ACQUIRE);
+    if (state == 0) {
+        // only the assembly being loaded is locked, others load alongside
+        pthread_mutex_lock(&slot->lock);
+        state = slot->state;
+        for (int i = 0; state == 0 && i < workspace->probeCount; i++) {
+            static const char * suffixes [] = { ".dll", ".exe" };
+            for (int j = 0; state == 0 && j < 2; j++) {
+                char path[WORKSPACE_NAME_MAX];
+                snprintf(path, sizeof(path), "%s/%s%s", workspace->probe[i], name, suffixes[j]);
+                if (access(path, R_OK) == 0 && load_assembly(&slot->assembly, path) == 0) {
+                    state = 1;
+                }
+            }
+        }
+        if (state == 0) {
+            state = -1;
+        }
+        __atomic_store_n(&slot->state, state, __ATOMIC_RELEASE);
+        pthread_mutex_unlock(&slot->lock);
+    }
+
+    return state == 1 ? &slot->assembly : 0;
+}
+
+static const char * heap_string(struct Context * context, uint32_t index)
+{
+    return (index < context->stringHeap.size) ? context->stringHeap.ptr + index : "";
+}
+
+struct Assembly * workspace_resolve_assembly(struct Workspace * workspace, struct Assembly * assembly, uint32_t assemblyRef)
+{
+    struct Context * context = &assembly->context;
+    if (assemblyRef == 0 || assemblyRef > context->tables[AssemblyRef].rowCount) {
+        return 0;
+    }
+
+    struct Resolved resolved;
+    uint32_t token = (AssemblyRef << 24) | assemblyRef;
+    int found = memo_get(workspace, assembly, token, &resolved);
+    if (found != 0) {
+        return found > 0 ? resolved.assembly : 0;
+    }
+
+    const char * name = heap_string(context, Row<AssemblyRef>(context->tables, assemblyRef - 1).Name());
+
+    resolved.assembly = workspace_load(workspace, name);
+    resolved.token = 0;
+    memo_put(workspace, assembly, token, resolved.assembly ? 0 : -1, &resolved);
+
+    return resolved.assembly;
+}
+
+// the TypeDef named name in assembly, or where its ExportedType forwards to
+static int find_type(struct Workspace * workspace, struct Assembly * assembly, const char * name, int depth, struct Resolved * out)
+{
+    if (assembly == 0 || depth > WORKSPACE_MAX_CHAIN) {
+        return -1;
+    }
+
+    struct Context * context = &assembly->context;
+
+    uint32_t row = clr_find_type(context, TypeDef, name);
+    if (row) {
+        out->assembly = assembly;
+        out->token = (TypeDef << 24) | row;
+        return 0;
+    }
+
+    row = clr_find_type(context, ExportedType, name);
+    if (row == 0) {
+        return -1;
+    }
+
+    // a nested forwarder points at its enclosing ExportedType, the
+    // outermost one names the assembly
+    int tab = ExportedType;
+    for (int i = 0; tab == ExportedType && i < WORKSPACE_MAX_CHAIN; i++) {
+        if (row == 0 || row > context->tables[ExportedType].rowCount) {
+            return -1;
+        }
+        row = Row<ExportedType>(context->tables, row - 1).Implementation(&tab);
+    }
+
+    if (tab != AssemblyRef) {
+        return -1; // File, another module of this assembly
+    }
+
+    return find_type(workspace, workspace_resolve_assembly(workspace, assembly, row), name, depth + 1, out);
+}
+
+int workspace_resolve_type(struct Workspace * workspace, struct Assembly * assembly, uint32_t typeRef, struct Resolved * out)
+{
+    struct Context * context = &assembly->context;
+    if (typeRef == 0 || typeRef > context->tables[TypeRef].rowCount) {
+        return -1;
+    }
+
+    uint32_t token = (TypeRef << 24) | typeRef;
+    int found = memo_get(workspace, assembly, token, out);
+    if (found != 0) {
+        return found > 0 ? 0 : -1;
+    }
+
+    // the outermost TypeRef of a nested one carries the real scope
+    int tab = TypeRef;
+    uint32_t scope = typeRef;
+    for (int i = 0; tab == TypeRef && i < WORKSPACE_MAX_CHAIN; i++) {
+        if (scope == 0 || scope > context->tables[TypeRef].rowCount) {
+            break;
+        }
+        scope = Row<TypeRef>(context->tables, scope - 1).ResolutionScope(&tab);
+    }
+
+    char name[WORKSPACE_NAME_MAX];
+    int ret = -1;
+
+    if (clr_type_name(context, TypeRef, typeRef, name, sizeof(name)) >= 0) {
+        if (scope == 0) {
+            // a null scope means the type is in this assembly's ExportedType table
+            ret = find_type(workspace, assembly, name, 0, out);
+        } else if (tab == Module) {
+            ret = find_type(workspace, assembly, name, 0, out);
+        } else if (tab == AssemblyRef) {
+            ret = find_type(workspace, workspace_resolve_assembly(workspace, assembly, scope), name, 0, out);
+        }
+    }
+
+    memo_put(workspace, assembly, token, ret, ret == 0 ? out : 0);
+
+    return ret;
+}
+
+// the TypeDef a TypeSpec of a generic instantiation stands for, or the
+// TypeRef it instantiates
+static int typespec_type(struct Context * context, uint32_t typeSpec, int * table, uint32_t * row)
+{
+    const struct Signature * sig = clr_row_signature(context, TypeSpec, typeSpec);
+    if (sig == 0 || sig->type->element != ELEMENT_TYPE_GENERICINST) {
+        return -1;
+    }
+
+    uint32_t token = sig->type->inner->token;
+    *table = token >> 24;
+    *row = token & 0xFFFFFF;
+    return 0;
+}
+
+static int same_type(struct Context * a, const struct SigType * x, struct Context * b, const struct SigType * y, int depth);
+
+// types of two assemblies are the same if they have the same full name,
+// the assembly a TypeRef points to is not compared
+static int same_token(struct Context * a, uint32_t x, struct Context * b, uint32_t y, int depth)
+{
+    if ((x >> 24) == TypeSpec || (y >> 24) == TypeSpec) {
+        const struct Signature * sx = clr_row_signature(a, TypeSpec, x & 0xFFFFFF);
+        const struct Signature * sy = clr_row_signature(b, TypeSpec, y & 0xFFFFFF);
+        return (x >> 24) == (y >> 24) && sx && sy && same_type(a, sx->type, b, sy->type, depth + 1);
+    }
+
+    char nx[WORKSPACE_NAME_MAX], ny[WORKSPACE_NAME_MAX];
+    return clr_type_name(a, x >> 24, x & 0xFFFFFF, nx, sizeof(nx)) >= 0
+        && clr_type_name(b, y >> 24, y & 0xFFFFFF, ny, sizeof(ny)) >= 0
+        && strcmp(nx, ny) == 0;
+}
+
+static int same_signature(struct Context * a, const struct Signature * x, struct Context * b, const struct Signature * y, int depth);
+
+static int same_type(struct Context * a, const struct SigType * x, struct Context * b, const struct SigType * y, int depth)
+{
+    if (depth > WORKSPACE_MAX_CHAIN || x->element != y->element || x->modCount != y->modCount) {
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < x->modCount; i++) {
+        if (x->mods[i].required != y->mods[i].required || !same_token(a, x->mods[i].token, b, y->mods[i].token, depth)) {
+            return 0;
+        }
+    }
+
+    switch(x->element) {
+        case ELEMENT_TYPE_CLASS:
+        case ELEMENT_TYPE_VALUETYPE:
+            return same_token(a, x->token, b, y->token, depth);
+        case ELEMENT_TYPE_VAR:
+        case ELEMENT_TYPE_MVAR:
+            return x->token == y->token;
+        case ELEMENT_TYPE_PTR:
+        case ELEMENT_TYPE_BYREF:
+        case ELEMENT_TYPE_SZARRAY:
+        case ELEMENT_TYPE_PINNED:
+            return same_type(a, x->inner, b, y->inner, depth + 1);
+        case ELEMENT_TYPE_ARRAY:
+            return x->shape->rank == y->shape->rank && same_type(a, x->inner, b, y->inner, depth + 1);
+        case ELEMENT_TYPE_GENERICINST:
+            if (x->argCount != y->argCount || !same_type(a, x->inner, b, y->inner, depth + 1)) {
+                return 0;
+            }
+            for (uint32_t i = 0; i < x->argCount; i++) {
+                if (!same_type(a, x->args[i], b, y->args[i], depth + 1)) {
+                    return 0;
+                }
+            }
+            return 1;
+        case ELEMENT_TYPE_FNPTR:
+            return same_signature(a, x->method, b, y->method, depth + 1);
+        default:
+            return 1;
+    }
+}
+
+// x is the reference: the vararg arguments after its sentinel are not part
+// of the definition y
+static int same_signature(struct Context * a, const struct Signature * x, struct Context * b, const struct Signature * y, int depth)
+{
+    uint32_t count = (x->sentinel >= 0) ? (uint32_t)x->sentinel : x->count;
+
+    if (x->kind != y->kind || ((x->callingConvention ^ y->callingConvention) & 0x7F) != 0
+            || x->genericCount != y->genericCount || count != y->count
+            || !same_type(a, x->type, b, y->type, depth + 1)) {
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (!same_type(a, x->types[i], b, y->types[i], depth + 1)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int workspace_resolve_member(struct Workspace * workspace, struct Assembly * assembly, uint32_t memberRef, struct Resolved * out)
+{
+    struct Context * context = &assembly->context;
+    if (memberRef == 0 || memberRef > context->tables[MemberRef].rowCount) {
+        return -1;
+    }
+
+    uint32_t token = (MemberRef << 24) | memberRef;
+    int found = memo_get(workspace, assembly, token, out);
+    if (found != 0) {
+        return found > 0 ? 0 : -1;
+    }
+
+    Row<MemberRef> member(context->tables, memberRef - 1);
+
+    int tab;
+    uint32_t parent = member.Class(&tab);
+
+    if (tab == TypeSpec && typespec_type(context, parent, &tab, &parent) != 0) {
+        tab = NotUsed;
+    }
+
+    struct Resolved type = { assembly, 0 };
+    int ret = -1;
+
+    switch(tab) {
+        case TypeDef:
+            type.token = (TypeDef << 24) | parent;
+            ret = 0;
+            break;
+        case TypeRef:
+            ret = workspace_resolve_type(workspace, assembly, parent, &type);
+            break;
+        case MethodDef:
+            // vararg call site of a method of this assembly
+            out->assembly = assembly;
+            out->token = (MethodDef << 24) | parent;
+            memo_put(workspace, assembly, token, 0, out);
+            return 0;
+        default:
+            break;
+    }
+
+    const struct Signature * sig = 0;
+    if (ret == 0 && (sig = clr_signature(context, member.Signature())) == 0) {
+        ret = -1;
+    }
+
+    if (ret == 0) {
+        ret = -1;
+
+        const char * name = heap_string(context, member.Name());
+        int table = (sig->kind == Sig_Field) ? Field : MethodDef;
+
+        struct Context * target = &type.assembly->context;
+        uint32_t first, count;
+        clr_member_range(target, table, type.token & 0xFFFFFF, &first, &count);
+
+        // the member of that name with the same signature, type names
+        // compared across the two assemblies
+        uint32_t match = 0;
+        for (uint32_t row = first; row < first + count; row++) {
+            uint32_t nameIndex, sigIndex;
+            if (table == MethodDef) {
+                Row<MethodDef> m(target->tables, row - 1);
+                nameIndex = m.Name(); sigIndex = m.Signature();
+            } else {
+                Row<Field> f(target->tables, row - 1);
+                nameIndex = f.Name(); sigIndex = f.Signature();
+            }
+
+            if (strcmp(heap_string(target, nameIndex), name) != 0) {
+                continue;
+            }
+
+            const struct Signature * candidate = clr_signature(target, sigIndex);
+            if (candidate && same_signature(context, sig, target, candidate, 0)) {
+                match = row;
+                break;
+            }
+        }
+
+        if (match) {
+            out->assembly = type.assembly;
+            out->token = (table << 24) | match;
+            ret = 0;
+        }
+    }
+
+    memo_put(workspace, assembly, token, ret, ret == 0 ? out : 0);
+
+    return ret;
+}
+
+// typeRef, or the reflection name "Ns.Outer+Inner, Assembly, Version=..."
+// of a named argument, which without an assembly is looked for in the
+// assembly itself and then in the ones it references
+static int enum_underlying(void * arg, struct Context * context, uint32_t typeRef, const char * name)
+{
+    struct Workspace * workspace = (struct Workspace*)arg;
+    struct Assembly * assembly = (struct Assembly*)((char*)context - offsetof(struct Assembly, context));
+    struct Resolved type;
+
+    if (typeRef) {
+        if (workspace_resolve_type(workspace, assembly, typeRef & 0xFFFFFF, &type) != 0) {
+            return 0;
+        }
+        return clr_enum_underlying(&type.assembly->context, type.token & 0xFFFFFF);
+    }
+
+    char typeName[WORKSPACE_NAME_MAX], assemblyName[WORKSPACE_NAME_MAX];
+    size_t len = strcspn(name, ",");
+    if (len >= sizeof(typeName)) {
+        return 0;
+    }
+    for (size_t i = 0; i < len; i++) {
+        typeName[i] = (name[i] == '+') ? '/' : name[i];
+    }
+    typeName[len] = 0;
+
+    assemblyName[0] = 0;
+    if (name[len] == ',') {
+        const char * start = name + len + 1 + strspn(name + len + 1, " ");
+        size_t n = strcspn(start, ", ");
+        if (n >= sizeof(assemblyName)) {
+            return 0;
+        }
+        memcpy(assemblyName, start, n);
+        assemblyName[n] = 0;
+    }
+
+    int found = -1;
+    if (assemblyName[0]) {
+        found = find_type(workspace, workspace_load(workspace, assemblyName), typeName, 0, &type);
+    } else {
+        found = find_type(workspace, assembly, typeName, 0, &type);
+        for (uint32_t row = 1; found != 0 && row <= context->tables[AssemblyRef].rowCount; row++) {
+            found = find_type(workspace, workspace_resolve_assembly(workspace, assembly, row), typeName, 0, &type);
+        }
+    }
+
+    return (found == 0) ? clr_enum_underlying(&type.assembly->context, type.token & 0xFFFFFF) : 0;
+}
+
+void workspace_resolve_enums(struct Workspace * workspace, struct Assembly * assembly)
+{
+    clr_set_enum_resolver(&assembly->context, enum_underlying, workspace);
+}
@@ -0,0 +1,55 @@
+#ifndef _CLRPARSER_WORKSPACE_H_
+#define _CLRPARSER_WORKSPACE_H_
+
+#include <stdint.h>
+
+#include "pe.h"
+#include "clr.h"
+
+// a set of assemblies that reference each other. assemblies are found by
+// simple name in the probe directories (name.dll, then name.exe), loaded
+// on first use and parsed once per workspace; several threads may load
+// and resolve at the same time. resolved references are memoized.
+
+struct Workspace;
+
+struct Assembly {
+    const char * name;  // simple name, as referenced
+    const char * path;
+    struct PEFile pe;
+    struct Context context;
+};
+
+// a row of some loaded assembly, token is table << 24 | row
+struct Resolved {
+    struct Assembly * assembly;
+    uint32_t token;
+};
+
+struct Workspace * workspace_open(const char ** probe, int count);
+void workspace_close(struct Workspace * workspace);
+
+// load an assembly by path, e.g. the application's entry assembly. it is
+// also registered under its Assembly table name.
+struct Assembly * workspace_add(struct Workspace * workspace, const char * path);
+
+// the assembly with the given simple name, loaded if needed; 0 if it can
+// not be found or parsed
+struct Assembly * workspace_load(struct Workspace * workspace, const char * name);
+
+// the assembly an AssemblyRef row of assembly refers to
+struct Assembly * workspace_resolve_assembly(struct Workspace * workspace, struct Assembly * assembly, uint32_t assemblyRef);
+
+// the TypeDef a TypeRef row refers to, following type forwarders through
+// ExportedType. returns 0, or -1 if it could not be resolved.
+int workspace_resolve_type(struct Workspace * workspace, struct Assembly * assembly, uint32_t typeRef, struct Resolved * out);
+
+// the MethodDef or Field a MemberRef row refers to, by name and signature
+// shape in the resolved parent type. returns 0, or -1.
+int workspace_resolve_member(struct Workspace * workspace, struct Assembly * assembly, uint32_t memberRef, struct Resolved * out);
+
+// decode the attribute values of assembly with the underlying types of
+// enums in the assemblies it references, see clr_set_enum_resolver
+void workspace_resolve_enums(struct Workspace * workspace, struct Assembly * assembly);
+
+#endif